@@ -89,6 +89,7 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
     } else if ( strncmp( "-w", args[curr], 3 ) == 0 ) {
       check_argc( args, curr, "ERROR: -w requires one argument." );
       c_fsm.recv_capacity = strtol( args[curr + 1], nullptr, 0 );
+      c_fsm.window_scale = c_fsm.recv_capacity > UINT16_MAX; // windows over 64 KiB need the scale option
       curr += 2;
 
     } else if ( strncmp( "-t", args[curr], 3 ) == 0 ) {
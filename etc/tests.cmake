@@ -45,6 +45,13 @@ ttest(recv_reorder)
 ttest(recv_reorder_more)
 ttest(recv_close)
 ttest(recv_special)
+ttest(recv_sack)
+ttest(recv_timestamps)
+ttest(recv_ecn)
+ttest(recv_early_drop)
+ttest(recv_zero_copy)
+ttest(recv_autotuning)
+ttest(recv_sws)
 
 ttest(send_connect)
 ttest(send_transmit)
@@ -53,6 +60,25 @@ ttest(send_ack)
 ttest(send_close)
 ttest(send_retx)
 ttest(send_extra)
+ttest(send_sack)
+ttest(send_nagle)
+ttest(send_pacing)
+ttest(send_mss)
+ttest(send_timestamps)
+ttest(send_rack_tlp)
+ttest(send_ecn)
+ttest(send_autotuning)
+ttest(send_stats)
+
+ttest(peer_delayed_ack)
+ttest(peer_window_update)
+ttest(peer_header_prediction)
+ttest(tcp_demux)
+ttest(tcp_listen)
+ttest(tcp_coalesce)
+ttest(tcp_fast_open)
+ttest(tcp_shards)
+ttest(timer_wheel)
 
 ttest(net_interface)
 
@@ -94,3 +120,5 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(peer_speed_test)
+stest(simulated_network_speed_test)
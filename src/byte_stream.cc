@@ -4,6 +4,12 @@ using namespace std;
 
 ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity ) {}
 
+void ByteStream::set_capacity( uint64_t capacity )
+{
+  // 已经缓冲的数据不能丢弃，容量最小缩到当前缓冲的字节数
+  capacity_ = std::max(capacity, buffered_);
+}
+
 void Writer::push( string data )
 {
   // 如果流已关闭，不进行任何操作
@@ -15,7 +21,42 @@ void Writer::push( string data )
   // 只追加允许容量内的数据
   if (push_size > 0) {
     try {
-      buffer_.append(data.substr(0, push_size));
+      // 很短的写入复制到tail_末尾：每次写入都分配一个切片（和它的引用计数）比复制几个字节代价更高
+      if (push_size < SMALL_PUSH) {
+        if (tail_.size() + push_size > MAX_TAIL) {
+          seal_tail();
+        }
+        tail_.append(data, 0, push_size);
+        buffered_ += push_size;
+        pushcnt_ += push_size;
+        return;
+      }
+
+      // 直接接管data的内存作为一个切片，不再拷贝
+      data.resize(push_size);
+      push(Slice {std::move(data)});
+    } catch (...) {
+      // 如果发生异常（如内存不足），设置错误状态
+      set_error();
+    }
+  }
+}
+
+void Writer::push( Slice data )
+{
+  // 如果流已关闭，不进行任何操作
+  if (is_close_) return;
+
+  // 计算能够推入的最大字节数
+  uint64_t push_size = std::min(data.size(), available_capacity());
+
+  // 只追加允许容量内的数据
+  if (push_size > 0) {
+    try {
+      // 保持顺序：先把tail_中较早写入的数据移入buffer_
+      seal_tail();
+      buffer_.push_back(data.substr(0, push_size));
+      buffered_ += push_size;
       // 更新已推入的字节计数
       pushcnt_ += push_size;
     } catch (...) {
@@ -23,8 +64,6 @@ void Writer::push( string data )
       set_error();
     }
   }
-  
-  return;
 }
 
 void Writer::close()
@@ -39,7 +78,7 @@ bool Writer::is_closed() const
 
 uint64_t Writer::available_capacity() const
 {
-  return (capacity_ - buffer_.size());
+  return (capacity_ - buffered_);
 }
 
 uint64_t Writer::bytes_pushed() const
@@ -47,24 +86,64 @@ uint64_t Writer::bytes_pushed() const
   return pushcnt_;
 }
 
+void ByteStream::seal_tail()
+{
+  if (tail_.size() == tail_popped_) {
+    return;
+  }
+  buffer_.push_back(Slice {std::move(tail_)}.substr(tail_popped_));
+  tail_.clear();
+  tail_popped_ = 0;
+}
+
 string_view Reader::peek() const
 {
-  // 如果buffer为空，返回空string_view
+  // 返回第一个切片（没有切片时是tail_中未读的部分）的string_view
+  if (buffer_.empty()) {
+    return string_view {tail_}.substr(tail_popped_);
+  }
+  return buffer_.front().view();
+}
+
+Slice Reader::peek_slice()
+{
+  // 切片需要共享的存储：tail_中的数据先移入buffer_
+  if (buffer_.empty()) {
+    seal_tail();
+  }
   if (buffer_.empty()) {
     return {};
   }
 
-  // 返回buffer的string_view，这是安全的因为buffer_在这个对象的生命周期内有效
-  return std::string_view(buffer_);
+  return buffer_.front();
 }
 
 void Reader::pop( uint64_t len )
 {
   // 防止pop超过buffer的大小
-  uint64_t pop_size = std::min(len, buffer_.size());
-
-  // 从buffer中移除已读的数据
-  buffer_ = buffer_.substr(pop_size);
+  uint64_t pop_size = std::min(len, buffered_);
+  buffered_ -= pop_size;
+
+  // 从buffer中移除已读的数据：整片丢弃，或者把第一个切片向后移动；切片读完后再读tail_
+  for (uint64_t remaining = pop_size; remaining > 0;) {
+    if (buffer_.empty()) {
+      tail_popped_ += remaining;
+      if (tail_popped_ == tail_.size()) {
+        // 全部读完：清空但保留容量，之后的短写入不必重新分配
+        tail_.clear();
+        tail_popped_ = 0;
+      }
+      break;
+    }
+    Slice& front = buffer_.front();
+    if (front.size() <= remaining) {
+      remaining -= front.size();
+      buffer_.pop_front();
+    } else {
+      front = front.substr(remaining);
+      remaining = 0;
+    }
+  }
 
   // 更新已弹出的字节计数
   popcnt_ += pop_size;
@@ -79,7 +158,7 @@ bool Reader::is_finished() const
 
 uint64_t Reader::bytes_buffered() const
 {
-  return buffer_.size();
+  return buffered_;
 }
 
 uint64_t Reader::bytes_popped() const
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "slice.hh"
+
 #include <cstdint>
+#include <deque>
 #include <string>
 #include <string_view>
 
@@ -18,6 +21,7 @@ public:
   Writer& writer();
   const Writer& writer() const;
   uint64_t capacity() const {return capacity_;}
+  void set_capacity( uint64_t capacity ); // Resize the stream (never below the bytes already buffered)
 
   void set_error() { error_ = true; };       // Signal that the stream suffered an error.
   bool has_error() const { return error_; }; // Has the stream had an error?
@@ -26,17 +30,27 @@ protected:
   // Please add any additional state to the ByteStream here, and not to the Writer and Reader interfaces.
   uint64_t capacity_;
   bool error_ {};
-  std::string buffer_ {};
+  std::deque<Slice> buffer_ {}; // 每次push的数据作为一个切片保存，pop时不复制
+  std::string tail_ {};         // 小的写入追加在这里（位于buffer_所有切片之后），不必每次都分配一个切片
+  uint64_t tail_popped_ {};     // tail_开头已经被读走的字节数
+  uint64_t buffered_ {};
   bool is_close_ {};
   uint64_t pushcnt_ {};
   uint64_t popcnt_ {};
 
+  static constexpr uint64_t SMALL_PUSH = 256;  // 短于这个长度的写入复制到tail_，更长的直接作为切片保存
+  static constexpr uint64_t MAX_TAIL = 4096;   // tail_攒到这么多字节就移入buffer_
+
+  void seal_tail(); // 把tail_中未读的字节作为一个切片移入buffer_（移动，不复制）
 };
 
 class Writer : public ByteStream
 {
 public:
-  void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
+  // Push data to stream, but only as much as available capacity allows. Short writes are gathered into one
+  // buffer, so that many tiny pushes don't each allocate.
+  void push( std::string data );
+  void push( Slice data );       // Same, keeping (part of) the Slice itself instead of copying its bytes.
   void close();                  // Signal that the stream has reached its ending. Nothing more will be written.
 
   bool is_closed() const;              // Has the stream been closed?
@@ -47,7 +61,10 @@ public:
 class Reader : public ByteStream
 {
 public:
-  std::string_view peek() const; // Peek at the next bytes in the buffer
+  // Peek at the next bytes in the buffer: a prefix of them (what one write, or several short ones, left there),
+  // not necessarily all that is buffered. Pop it and peek again for the rest. Valid until the next push or pop.
+  std::string_view peek() const;
+  Slice peek_slice();            // Same bytes as peek(), as a Slice sharing the buffer (no copy)
   void pop( uint64_t len );      // Remove `len` bytes from the buffer
 
   bool is_finished() const;        // Is the stream finished (closed and fully popped)?
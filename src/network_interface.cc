@@ -44,7 +44,8 @@ void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Addre
     return;
   }
 
-  pending_datagram_timers_.emplace( next_hop_ip, Timer {} );
+  pending_datagram_timers_.emplace( next_hop_ip,
+                                   timers_.schedule( timers_.now() + ARP_REQUEST_PERIOD_ms, { next_hop_ip, true } ) );
 
   const ARPMessage arp_request = {
     .opcode = ARPMessage::OPCODE_REQUEST,
@@ -83,7 +84,13 @@ void NetworkInterface::recv_frame( EthernetFrame frame )
     const AddressNumber sender_ip = msg.sender_ip_address;
     const EthernetAddress sender_eth = msg.sender_ethernet_address;
 
-    arp_cache_[sender_ip] = { sender_eth, 0};
+    // 学习（或刷新）映射：重新开始30秒的过期计时
+    auto [entry, inserted] = arp_cache_.try_emplace( sender_ip, ArpEntry { sender_eth, {} } );
+    if (!inserted) {
+      timers_.cancel( entry->second.expiry );
+      entry->second.ethernet_address = sender_eth;
+    }
+    entry->second.expiry = timers_.schedule( timers_.now() + ARP_ENTRY_TTL_ms, { sender_ip, false } );
 
     // 处理ARP请求
     if (msg.opcode == ARPMessage::OPCODE_REQUEST && msg.target_ip_address == ip_address_.ipv4_numeric()) {
@@ -105,6 +112,7 @@ void NetworkInterface::recv_frame( EthernetFrame frame )
         transmit({ { sender_eth, ethernet_address_, EthernetHeader::TYPE_IPv4 }, serialize(dgram) });
       }
       pending_datagrams_.erase(it);
+      timers_.cancel(pending_datagram_timers_.at(sender_ip));
       pending_datagram_timers_.erase(sender_ip);
     }
   }
@@ -115,21 +123,13 @@ void NetworkInterface::recv_frame( EthernetFrame frame )
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void NetworkInterface::tick( const size_t ms_since_last_tick )
 {
-  for (auto it = arp_cache_.begin(); it != arp_cache_.end(); ) {
-    it->second.timer += ms_since_last_tick;
-    if (it->second.timer >= ARP_ENTRY_TTL_ms) 
-      it = arp_cache_.erase(it);
-    else 
-      ++it;
-  }
-
-  for (auto it = pending_datagram_timers_.begin(); it != pending_datagram_timers_.end(); ) {
-    it->second += ms_since_last_tick;
-    if (it->second >= ARP_REQUEST_PERIOD_ms) {
-      pending_datagrams_.erase(it->first);
-      it = pending_datagram_timers_.erase(it);
+  // 只处理到期的定时器：过期的ARP表项，以及超时仍未得到回复的ARP请求（丢弃等待它的数据报）
+  timers_.advance( ms_since_last_tick, [this]( const ArpTimer& timer ) {
+    if (timer.request) {
+      pending_datagrams_.erase(timer.ip_address);
+      pending_datagram_timers_.erase(timer.ip_address);
     } else {
-      ++it;
+      arp_cache_.erase(timer.ip_address);
     }
-  }
+  } );
 }
@@ -3,6 +3,7 @@
 #include "address.hh"
 #include "ethernet_frame.hh"
 #include "ipv4_datagram.hh"
+#include "timer_wheel.hh"
 
 #include <memory>
 #include <queue>
@@ -80,18 +81,25 @@ private:
 
   static constexpr size_t ARP_ENTRY_TTL_ms = 30'000;
   static constexpr size_t ARP_REQUEST_PERIOD_ms = 5'000;
-  using Timer = uint64_t;
   using AddressNumber = uint32_t;
 
+  // ARP表项过期和ARP请求超时都登记在时间轮上，tick()只处理到期的定时器，而不是扫描所有表项
+  struct ArpTimer {
+    AddressNumber ip_address {};
+    bool request {}; // true：ARP请求超时；false：ARP表项过期
+  };
+  using Timers = TimerWheel<ArpTimer>;
+  Timers timers_ {};
+
   struct ArpEntry {
     EthernetAddress ethernet_address;
-    Timer timer;
+    Timers::TimerId expiry;
   };
 
   //ip to anything
   std::unordered_map <AddressNumber, ArpEntry> arp_cache_ {};
   std::unordered_map <AddressNumber, std::vector<InternetDatagram>> pending_datagrams_ {};
-  std::unordered_map <AddressNumber, Timer> pending_datagram_timers_ {};
+  std::unordered_map <AddressNumber, Timers::TimerId> pending_datagram_timers_ {};
 };
 
 // 中文翻译说明：
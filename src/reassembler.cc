@@ -5,130 +5,77 @@ using namespace std;
 
 void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring )
 {
-  //data.empty, handle eof_ and eof_index_, check if next_index_ == eof_index_
+  insert(first_index, Slice {std::move(data)}, is_last_substring);
+}
+
+void Reassembler::insert( uint64_t first_index, Slice data, bool is_last_substring )
+{
   //仅仅 is_last_substring == true 并不能保证流可以关闭。TCP流的结束条件是所有数据都已经被正确组装并写入ByteStream，
   //也就是 next_index_ == eof_index_。
   //如果只判断 is_last_substring，可能还有未组装的数据片段（比如乱序、丢包等），此时不能关闭流，否则会丢失数据。
-
   if (is_last_substring) {
     eof_ = true;
     eof_index_ = first_index + data.size();
+  }
 
-    if (next_index_ == eof_index_) {
-      output_.writer().close();
+  //用目前的窗口大小来切割数据：只保留 [next_index_, next_index_ + available_capacity) 之内的部分
+  const uint64_t acceptable_end = next_index_ + output_.writer().available_capacity();
+  const uint64_t actual_start = max(first_index, next_index_);
+  const uint64_t actual_end = min(first_index + data.size(), acceptable_end);
+
+  if (actual_start < actual_end) {
+    // 切片共享原来的内存，不复制
+    const Slice usable_data = data.substr(actual_start - first_index, actual_end - actual_start);
+
+    if (actual_start == next_index_) {
+      // merged into output_ instantly
+      output_.writer().push(usable_data);
+      next_index_ += usable_data.size();
+
+      // 写入缓存中已经连续的片段（和已写入部分重叠的字节跳过）
+      while (!unassembled_.empty() && unassembled_.begin()->first <= next_index_) {
+        const auto it = unassembled_.begin();
+        const uint64_t overlap = next_index_ - it->first;
+        if (overlap < it->second.size()) {
+          output_.writer().push(it->second.substr(overlap));
+          next_index_ += it->second.size() - overlap;
+        }
+        unassembled_.erase(it);
+      }
+    } else {
+      store(actual_start, usable_data);
     }
   }
 
-  if (data.empty()) return;
-
   //每次写入数据后、每次插入新片段后,判断 eof_ && next_index_ == eof_index_
-  if (first_index + data.size() <= next_index_) {
-    if (eof_ && next_index_ == eof_index_) {
-      output_.writer().close();
-    }
-    return;
+  if (eof_ && next_index_ == eof_index_) {
+    output_.writer().close();
   }
+}
 
-  //bytestream capacity check
-  uint64_t available_capacity = output_.writer().available_capacity();
-
-  uint64_t acceptable_end = next_index_ + available_capacity;
-
-  //all out of acceptable
-  if (first_index >= acceptable_end) {
-    return;
+void Reassembler::store( uint64_t index, const Slice& data )
+{
+  const uint64_t start = index;
+  const uint64_t end = index + data.size();
+
+  // 跳过前一个片段已经覆盖的部分
+  auto it = unassembled_.upper_bound(index);
+  if (it != unassembled_.begin()) {
+    const auto prev = std::prev(it);
+    index = max(index, prev->first + prev->second.size());
   }
 
-  //用目前的窗口大小来切割数据
-  uint64_t actual_start = max(first_index, next_index_);
-  uint64_t actual_end = min(first_index + data.size(), acceptable_end);
-
-  uint64_t offset = actual_start - first_index;
-  uint64_t length = actual_end - actual_start;
-
-  string usable_data = data.substr(offset, length);
-  uint64_t usable_index = actual_start;
-  
-  // merged into output_ instantly
-  if (usable_index == next_index_) {
-    output_.writer().push(usable_data);
-    next_index_ += usable_data.size();
-
-    while (!unassembled_.empty()) {
-      auto it = unassembled_.begin();
-      if (it->first > next_index_) {
-        break;
-      }
-
-      //overlap means bytes need to pass
-      //substr(n) means ...
-      uint64_t overlap = next_index_ - it->first;
-      if (overlap < it->second.size()) {
-        string new_data = it->second.substr(overlap);
-        output_.writer().push(new_data);
-        next_index_ += new_data.size();
-      }
-
-      unassembled_.erase(it);
+  // 依次填补和后续片段之间的空隙
+  while (index < end) {
+    const uint64_t gap_end = it == unassembled_.end() ? end : min(end, it->first);
+    if (gap_end > index) {
+      unassembled_.emplace_hint(it, index, data.substr(index - start, gap_end - index));
     }
-  } else if (usable_data.size() > 0){
-    // 查找插入位置或合并点
-    auto it = unassembled_.lower_bound(usable_index);
-
-    // 尝试与前一个片段合并
-    if (it != unassembled_.begin()) {
-      auto prev = std::prev(it);  // 获取前一个片段
-      uint64_t prev_end = prev->first + prev->second.size();  // 计算结束位置
-
-      // 检查是否有重叠
-      if (prev_end >= usable_index) {
-        // 如果前一个片段部分覆盖当前片段
-        if (prev_end < usable_index + usable_data.size()) {
-          // 计算需要扩展的长度
-          uint64_t extend_len = usable_index + usable_data.size() - prev_end;
-          // 拼接未被覆盖的部分
-          prev->second += usable_data.substr(usable_data.size() - extend_len);
-        }
-
-        // 如果前一个片段完全覆盖当前片段，不需要存储
-        if (prev_end >= usable_index + usable_data.size()) {
-          if (eof_ && next_index_ == eof_index_) {
-            output_.writer().close();
-          }
-          return;
-        }
-
-        // 更新合并后的片段信息
-        usable_index = prev->first;
-        usable_data = prev->second;
-        unassembled_.erase(prev);  // 删除旧的片段
-      }
-    }
-
-    // 尝试与后续片段合并
-    while (it != unassembled_.end() && it->first <= usable_index + usable_data.size()) {
-      uint64_t it_end = it->first + it->second.size();
-
-      // 如果后续片段有新数据
-      if (it_end > usable_index + usable_data.size()) {
-        // 计算需要扩展的长度
-        uint64_t extend_len = it_end - (usable_index + usable_data.size());
-        // 拼接新数据
-        usable_data += it->second.substr(it->second.size() - extend_len);
-      }
-
-      // 删除已合并的片段
-      auto to_erase = it;
-      ++it;  // 先移动迭代器再删除
-      unassembled_.erase(to_erase);
+    if (it == unassembled_.end()) {
+      break;
     }
-
-    // 存储合并后的片段
-    unassembled_[usable_index] = usable_data;
-  }
-
-  if (eof_ && next_index_ == eof_index_) {
-    output_.writer().close();
+    index = max(index, it->first + it->second.size());
+    ++it;
   }
 }
 
@@ -146,3 +93,19 @@ uint64_t Reassembler::count_bytes_pending() const
   return total;
 }
 
+// 缓存中的片段互不重叠，相邻的片段在这里合并成一个极大的连续区间
+vector<pair<uint64_t, uint64_t>> Reassembler::unassembled_ranges() const
+{
+  vector<pair<uint64_t, uint64_t>> ranges;
+  for (const auto& [index, data] : unassembled_) {
+    if (index + data.size() <= next_index_) {
+      continue;
+    }
+    if (!ranges.empty() && ranges.back().second == index) {
+      ranges.back().second += data.size();
+    } else {
+      ranges.emplace_back(max(index, next_index_), index + data.size());
+    }
+  }
+  return ranges;
+}
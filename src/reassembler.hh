@@ -2,6 +2,8 @@
 
 #include "byte_stream.hh"
 #include <map>
+#include <utility>
+#include <vector>
 
 class Reassembler
 {
@@ -35,10 +37,23 @@ public:
    */
   void insert( uint64_t first_index, std::string data, bool is_last_substring );
 
+  // Same as above, but the bytes are kept as (parts of) the given Slice, without being copied.
+  void insert( uint64_t first_index, Slice data, bool is_last_substring );
+
   // How many bytes are stored in the Reassembler itself?
   // This function is for testing only; don't add extra state to support it.
   uint64_t count_bytes_pending() const;
 
+  // Is any out-of-order data waiting for a gap to fill? (cheaper than count_bytes_pending() for a yes/no answer)
+  bool has_pending() const { return !unassembled_.empty(); }
+
+  // Which ranges [first, last) of the stream are stored in the Reassembler, in increasing order?
+  // (Used by the TCPReceiver to generate selective acknowledgments.)
+  std::vector<std::pair<uint64_t, uint64_t>> unassembled_ranges() const;
+
+  // Grow the output stream (for receive-window autotuning; never below the bytes it already holds)
+  void set_capacity( uint64_t capacity ) { output_.set_capacity( capacity ); }
+
   // Access output stream reader
   Reader& reader() { return output_.reader(); }
   const Reader& reader() const { return output_.reader(); }
@@ -52,5 +67,7 @@ private:
   uint64_t next_index_;
   bool eof_;
   uint64_t eof_index_;
-  std::map<uint64_t, std::string> unassembled_;
+  std::map<uint64_t, Slice> unassembled_; // 互不重叠的乱序片段（相邻片段不合并，避免拷贝）
+
+  void store( uint64_t index, const Slice& data ); // 只保存data中还没有被已有片段覆盖的部分
 };
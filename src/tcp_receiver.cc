@@ -1,10 +1,15 @@
 #include "tcp_receiver.hh"
 #include "debug.hh"
 
+#include <algorithm>
+
 using namespace std;
 
 void TCPReceiver::receive( TCPSenderMessage message )
 {
+  // 上次之后应用可能读走了数据：先决定窗口右边界是否前移（数据到达不会移动它）
+  update_right_edge();
+
   // 处理RST标志
   if (message.RST) {
     reassembler_.reader().set_error();
@@ -24,12 +29,221 @@ void TCPReceiver::receive( TCPSenderMessage message )
   // 计算绝对序列号和流索引
   const uint64_t checkpoint = reassembler_.writer().bytes_pushed();
   const uint64_t abs_seqno = message.seqno.unwrap(isn_.value(), checkpoint);
+
+  // PAWS：时间戳比TS.Recent旧的段来自序列号回绕之前，丢弃（按32位回绕比较）
+  if (timestamps_ && message.tsval.has_value() && !message.SYN && ts_recent_.has_value()
+      && static_cast<int32_t>(*message.tsval - *ts_recent_) < 0) {
+    paws_rejected_++;
+    return;
+  }
   
+  // ECN：CWR表示对端已经降速，停止回显；CE表示路径上出现了拥塞，之后的ACK都带ECE
+  if (ecn_) {
+    if (message.CWR) {
+      ece_ = false;
+    }
+    if (message.ecn == TCPSenderMessage::ECN_CE) {
+      ece_ = true;
+    }
+  }
+
   // 确定流索引（字节流中的位置）
   const uint64_t stream_index = message.SYN ? 0 : abs_seqno - 1;
   
-  // 插入数据到重组器
-  reassembler_.insert(stream_index, message.payload, message.FIN);
+  // 不携带数据也不带FIN的段（纯ACK、重复的SYN）不需要交给重组器
+  const bool occupies_stream = !message.payload.empty() || message.FIN;
+  if (occupies_stream && !accept_segment(stream_index, message.payload.size(), message.FIN)) {
+    return;
+  }
+
+  // 段被接受（或是纯ACK）之后才更新要回显的时间戳：被丢弃的段不能移动TS.Recent
+  update_ts_recent(message, abs_seqno);
+
+  if (occupies_stream) {
+    // 插入数据到重组器（负载切片直接移交，不复制）
+    reassembler_.insert(stream_index, std::move(message.payload), message.FIN);
+  }
+
+  if (autotuning_) {
+    measure_rtt();
+    adjust_capacity();
+  }
+}
+
+bool TCPReceiver::predicts( const TCPSenderMessage& message ) const
+{
+  if (!isn_.has_value() || message.SYN || message.FIN || message.RST || message.CWR
+      || message.ecn == TCPSenderMessage::ECN_CE) {
+    return false;
+  }
+
+  // 正好是下一个期望的段，没有乱序数据等待重组，数据能全部放进窗口，流还没有结束或出错
+  const Writer& writer = reassembler_.writer();
+  if (message.seqno != Wrap32::wrap(1 + writer.bytes_pushed(), isn_.value()) || reassembler_.has_pending()
+      || message.payload.size() > writer.available_capacity() || writer.is_closed() || reader().has_error()) {
+    return false;
+  }
+
+  // PAWS：时间戳不能比TS.Recent旧
+  if (timestamps_ && message.tsval.has_value() && ts_recent_.has_value()) {
+    return static_cast<int32_t>(*message.tsval - *ts_recent_) >= 0;
+  }
+  return true;
+}
+
+void TCPReceiver::receive_predicted( TCPSenderMessage message )
+{
+  update_right_edge();
+
+  // 段从ackno开始；延迟ACK时ackno可能已经超过了Last.ACK.sent，这时仍回显更早的时间戳
+  update_ts_recent(message, 1 + reassembler_.writer().bytes_pushed());
+
+  if (!message.payload.empty()) {
+    in_order_segments_++;
+    reassembler_.insert(reassembler_.writer().bytes_pushed(), std::move(message.payload), false);
+  }
+
+  if (autotuning_) {
+    measure_rtt();
+    adjust_capacity();
+  }
+}
+
+void TCPReceiver::update_ts_recent( const TCPSenderMessage& message, uint64_t abs_seqno )
+{
+  if (message.tsval.has_value()
+      && (message.SYN || (last_ack_sent_.has_value() && abs_seqno <= *last_ack_sent_))) {
+    ts_recent_ = message.tsval;
+  }
+}
+
+bool TCPReceiver::accept_segment( uint64_t stream_index, uint64_t length, bool fin )
+{
+  const uint64_t pushed = reassembler_.writer().bytes_pushed();
+  const uint64_t data_end = stream_index + length;
+  const uint64_t window_end = pushed + reassembler_.writer().available_capacity();
+
+  // 完全是已经收到的数据（FIN也已经收到过）：重传风暴中的重复段，不必经过重组器
+  if (data_end < pushed || (data_end == pushed && (!fin || reassembler_.writer().is_closed()))) {
+    duplicate_segments_++;
+    return false;
+  }
+
+  // 完全在窗口之外（只带FIN的段不占用缓冲区，紧贴窗口右边界时仍然可以接受）
+  if (stream_index > window_end || (stream_index == window_end && length > 0)) {
+    beyond_window_segments_++;
+    return false;
+  }
+
+  if (stream_index > pushed) {
+    out_of_order_segments_++;
+    // 记录乱序片段的位置，用于生成SACK块
+    if (length > 0) {
+      last_ooo_index_ = stream_index;
+    }
+  } else {
+    in_order_segments_++;
+  }
+  return true;
+}
+
+void TCPReceiver::set_sws_avoidance( bool enabled, uint64_t mss )
+{
+  sws_avoidance_ = enabled;
+  sws_mss_ = mss;
+  update_right_edge();
+}
+
+void TCPReceiver::update_right_edge()
+{
+  if (!sws_avoidance_)
+    return;
+
+  // 应用每次只读走几个字节时，不要把窗口一点一点地打开（否则对端会发送很小的段）：
+  // 右边界只有在能前移min(MSS, 缓冲区的一半)时才前移，否则保持不变，窗口随数据到达而缩小
+  const uint64_t edge = reassembler_.writer().bytes_pushed() + reassembler_.writer().available_capacity();
+  const uint64_t threshold = min(sws_mss_, reassembler_.writer().capacity() / 2);
+  if (edge >= right_edge_ + threshold) {
+    right_edge_ = edge;
+  }
+}
+
+uint64_t TCPReceiver::advertised_window() const
+{
+  const uint64_t pushed = reassembler_.writer().bytes_pushed();
+  uint64_t window = reassembler_.writer().available_capacity();
+
+  if (sws_avoidance_) {
+    window = right_edge_ > pushed ? right_edge_ - pushed : 0;
+  }
+
+  return min(window >> window_shift_, static_cast<uint64_t>(UINT16_MAX));
+}
+
+uint64_t TCPReceiver::window_edge() const
+{
+  return reassembler_.writer().bytes_pushed() + (advertised_window() << window_shift_);
+}
+
+void TCPReceiver::set_receive_autotuning( bool enabled, uint64_t max_capacity )
+{
+  autotuning_ = enabled;
+  max_capacity_ = max_capacity;
+}
+
+void TCPReceiver::tick( uint64_t ms_since_last_tick )
+{
+  now_ms_ += ms_since_last_tick;
+  if (autotuning_) {
+    adjust_capacity();
+  }
+  update_right_edge();
+}
+
+void TCPReceiver::measure_rtt()
+{
+  const uint64_t pushed = reassembler_.writer().bytes_pushed();
+
+  // 收满了测量开始时通告的窗口：得到一个RTT样本
+  if (rtt_seq_.has_value() && pushed >= *rtt_seq_) {
+    const uint64_t sample = max(now_ms_ - rtt_start_ms_, uint64_t {1});
+    if (!rtt_ms_.has_value()) {
+      // 第一个样本：从现在开始统计应用的读取速度
+      space_start_ms_ = now_ms_;
+      space_popped_ = reassembler_.reader().bytes_popped();
+    }
+    // 更小的样本直接采用，否则做指数加权平均（样本是RTT的上界）
+    rtt_ms_ = (!rtt_ms_.has_value() || sample < *rtt_ms_) ? sample : (7 * *rtt_ms_ + sample) / 8;
+    rtt_seq_.reset();
+  }
+
+  // 开始下一次测量：记录当前通告窗口的右边界（窗口为0时等到窗口打开）
+  const uint64_t window = reassembler_.writer().available_capacity();
+  if (!rtt_seq_.has_value() && window > 0) {
+    rtt_seq_ = pushed + window;
+    rtt_start_ms_ = now_ms_;
+  }
+}
+
+void TCPReceiver::adjust_capacity()
+{
+  if (!rtt_ms_.has_value() || now_ms_ - space_start_ms_ < *rtt_ms_) {
+    return;
+  }
+
+  // 应用在这个RTT内读取的字节数；超过以往的最大值时，把缓冲区增大到它的两倍
+  // （一个RTT的数据在路上时，应用还要能读完上一个RTT的数据）
+  const uint64_t copied = reassembler_.reader().bytes_popped() - space_popped_;
+  if (copied > space_) {
+    space_ = copied;
+    const uint64_t target = min(2 * copied, max_capacity_);
+    if (target > reassembler_.writer().capacity()) {
+      reassembler_.set_capacity(target);
+    }
+  }
+
+  space_start_ms_ = now_ms_;
+  space_popped_ = reassembler_.reader().bytes_popped();
 }
 
 TCPReceiverMessage TCPReceiver::send() const 
@@ -46,14 +260,50 @@ TCPReceiverMessage TCPReceiver::send() const
     msg.ackno = Wrap32::wrap(abs_ackno, isn_.value());
   }
   
-  // 设置窗口大小（上限为uint16_t最大值）
-  const uint64_t window_size = reassembler_.writer().available_capacity();
-  msg.window_size = static_cast<uint16_t>(
-      std::min(window_size, static_cast<uint64_t>(UINT16_MAX)));
+  // 设置窗口大小：按协商的缩放因子右移后，上限为uint16_t最大值
+  msg.window_size = static_cast<uint16_t>(advertised_window());
   
   // 设置RST标志（如果流有错误）
   msg.RST = reassembler_.reader().has_error();
-  
+
+  // 回显拥塞标记
+  msg.ECE = ece_;
+
+  // 回显时间戳
+  if (timestamps_) {
+    msg.tsecr = ts_recent_;
+  }
+
+  // 生成SACK块：第一个块包含最近收到的乱序片段（RFC 2018），其余从高到低排列
+  if (sack_enabled_ && isn_.has_value()) {
+    auto ranges = reassembler_.unassembled_ranges();
+    const auto to_block = [&](const pair<uint64_t, uint64_t>& range) {
+      // 流索引 + 1(SYN) = 绝对序列号
+      return SACKBlock {Wrap32::wrap(range.first + 1, isn_.value()), Wrap32::wrap(range.second + 1, isn_.value())};
+    };
+
+    if (last_ooo_index_.has_value()) {
+      const auto recent = find_if(ranges.begin(), ranges.end(), [&](const auto& range) {
+        return range.first <= *last_ooo_index_ && *last_ooo_index_ < range.second;
+      });
+      if (recent != ranges.end()) {
+        msg.sack.push_back(to_block(*recent));
+        ranges.erase(recent);
+      }
+    }
+
+    for (auto it = ranges.rbegin(); it != ranges.rend() && msg.sack.size() < TCPReceiverMessage::MAX_SACK_BLOCKS; ++it) {
+      msg.sack.push_back(to_block(*it));
+    }
+  }
+
   return msg;
 }
 
+void TCPReceiver::sent( const TCPReceiverMessage& message )
+{
+  if (isn_.has_value() && message.ackno.has_value()) {
+    last_ack_sent_ = message.ackno->unwrap(isn_.value(), reassembler_.writer().bytes_pushed());
+  }
+}
+
@@ -17,9 +17,62 @@ public:
    */
   void receive( TCPSenderMessage message );
 
+  /*
+   * Header prediction: is this the next segment in order, carrying no flags and nothing but data that fits
+   * in the window (or no data at all)? Such a segment can be handed to receive_predicted() instead.
+   */
+  bool predicts( const TCPSenderMessage& message ) const;
+
+  // Receive a segment for which predicts() returned true
+  void receive_predicted( TCPSenderMessage message );
+
   // The TCPReceiver sends TCPReceiverMessages to the peer's TCPSender.
   TCPReceiverMessage send() const;
 
+  // A message from send() has gone out to the peer: its ackno is the one timestamps are echoed against
+  // (Last.ACK.sent, RFC 7323 section 4.3)
+  void sent( const TCPReceiverMessage& message );
+
+  // Report out-of-order data with selective acknowledgments (enabled when both peers agree on the SYN exchange)
+  void set_sack_enabled( bool enabled ) { sack_enabled_ = enabled; }
+
+  // Scale down advertised windows by this shift count (RFC 7323, agreed on the SYN exchange)
+  void set_window_shift( uint8_t shift ) { window_shift_ = shift; }
+
+  // Echo the peer's timestamps and reject segments with old ones (PAWS, RFC 7323)
+  void set_timestamps( bool enabled ) { timestamps_ = enabled; }
+
+  // Receiver-side silly window syndrome avoidance (RFC 1122, section 4.2.3.3): only advertise a window opening
+  // once it reaches min(`mss`, half the buffer)
+  void set_sws_avoidance( bool enabled, uint64_t mss );
+
+  // The right edge of the advertised window, as a stream index (grows when the window is worth announcing)
+  uint64_t window_edge() const;
+
+  // Echo congestion marks (CE) back to the peer with ECE until it answers with CWR (RFC 3168)
+  void set_ecn( bool enabled ) { ecn_ = enabled; }
+
+  // Dynamic right-sizing: once per round trip, grow the inbound stream to twice what the application read
+  // in that round trip (up to `max_capacity`), so the advertised window doesn't hold back a fast reader
+  void set_receive_autotuning( bool enabled, uint64_t max_capacity );
+
+  // Time has passed by the given # of milliseconds (used to measure the round-trip time and the read rate, and
+  // to open a window held back by SWS avoidance once the application has read enough)
+  void tick( uint64_t ms_since_last_tick );
+
+  // How many segments have been discarded by PAWS?
+  uint64_t paws_rejected() const { return paws_rejected_; }
+
+  // How many data segments (or FINs) were in order, out of order within the window, entirely duplicates of
+  // bytes already received, or entirely beyond the window? Only the first two reach the Reassembler.
+  uint64_t in_order_segments() const { return in_order_segments_; }
+  uint64_t out_of_order_segments() const { return out_of_order_segments_; }
+  uint64_t duplicate_segments() const { return duplicate_segments_; }
+  uint64_t beyond_window_segments() const { return beyond_window_segments_; }
+
+  // Round-trip time measured by the receiver (empty until a whole window of data has arrived)
+  std::optional<uint64_t> rtt_ms() const { return rtt_ms_; }
+
   // Access the output
   const Reassembler& reassembler() const { return reassembler_; }
   Reader& reader() { return reassembler_.reader(); }
@@ -29,4 +82,56 @@ public:
 private:
   Reassembler reassembler_;
   std::optional<Wrap32> isn_ {};
+
+  bool sack_enabled_ {};                      // 是否生成SACK块
+  std::optional<uint64_t> last_ooo_index_ {}; // 最近一个乱序到达片段的流索引（SACK的第一个块要包含它）
+  uint8_t window_shift_ {};                   // 通告窗口右移的位数（窗口缩放）
+
+  bool timestamps_ {};                        // 是否回显时间戳并做PAWS检查
+  std::optional<uint32_t> ts_recent_ {};      // 要回显给对端的TSval（RFC 7323的TS.Recent）
+  std::optional<uint64_t> last_ack_sent_ {};  // 最近一次发给对端的绝对ackno（RFC 7323的Last.ACK.sent）
+  uint64_t paws_rejected_ {};                 // 因时间戳过旧被丢弃的段数
+
+  uint64_t in_order_segments_ {};             // 从ackno开始（或与已收到的数据部分重叠）的段
+  uint64_t out_of_order_segments_ {};         // 窗口内、ackno之后的乱序段
+  uint64_t duplicate_segments_ {};            // 完全是已收到数据的重复段（提前丢弃）
+  uint64_t beyond_window_segments_ {};        // 完全在窗口之外的段（提前丢弃）
+
+  bool sws_avoidance_ {};                     // 是否避免糊涂窗口综合征（SWS）
+  uint64_t sws_mss_ {};                       // 对端发送的最大段长（窗口至少要打开这么多才通告）
+  uint64_t right_edge_ {};                    // 已经通告的窗口右边界（流索引），只在增长足够多时前移
+
+  bool ecn_ {};                               // 是否处理ECN拥塞标记
+  bool ece_ {};                               // 收到CE标记后置位，直到对端发来CWR
+
+  bool autotuning_ {};                        // 是否按应用的读取速度调整接收缓冲区（DRS）
+  uint64_t max_capacity_ {};                  // 接收缓冲区允许增长到的上限
+  uint64_t now_ms_ {};                        // tick()累计的当前时间（毫秒）
+
+  std::optional<uint64_t> rtt_ms_ {};         // 接收方估计的RTT
+  std::optional<uint64_t> rtt_seq_ {};        // 正在进行的RTT测量：通告窗口的右边界（流索引）
+  uint64_t rtt_start_ms_ {};                  // 正在进行的RTT测量的开始时刻
+  // 发送方受窗口限制时，从通告一个窗口到收满它大约需要一个RTT（数据较少时偏大，作为上界）
+
+  uint64_t space_ {};                         // 目前为止应用在一个RTT内读取的最多字节数
+  uint64_t space_start_ms_ {};                // 当前统计周期（一个RTT）的开始时刻
+  uint64_t space_popped_ {};                  // 当前统计周期开始时应用已经读取的字节数
+
+  void update_right_edge();
+  // 应用读走的数据足够多时前移窗口右边界；在receive()和tick()中调用，通告窗口只取决于已经确定的右边界
+
+  uint64_t advertised_window() const;
+  // 要通告的窗口（已按缩放因子右移，上限为uint16_t最大值）
+
+  void update_ts_recent( const TCPSenderMessage& message, uint64_t abs_seqno );
+  // 段被接受之后，起点不晚于Last.ACK.sent（或是SYN）时，记下它的时间戳用于回显
+
+  bool accept_segment( uint64_t stream_index, uint64_t length, bool fin );
+  // 重组之前给数据段分类并计数；重复的段和窗口之外的段返回false（提前丢弃）
+
+  void measure_rtt();
+  // 数据到达后检查RTT测量是否完成，并开始下一次测量
+
+  void adjust_capacity();
+  // 每个RTT统计一次应用读取的字节数，读取得越多，接收缓冲区越大（只增不减）
 };
@@ -2,6 +2,8 @@
 #include "debug.hh"
 #include "tcp_config.hh"
 
+#include <iterator>
+
 using namespace std;
 
 // This function is for testing only; don't add extra state to support it.
@@ -16,12 +18,61 @@ uint64_t TCPSender::consecutive_retransmissions() const
   return consecutive_retransmissions_;
 }
 
+optional<uint64_t> TCPSender::next_timeout_ms() const
+{
+  optional<uint64_t> next;
+  const auto earliest = [&](uint64_t deadline_ms) {
+    const uint64_t remaining = deadline_ms > now_ms_ ? deadline_ms - now_ms_ : 0;
+    next = min(next.value_or(remaining), remaining);
+  };
+
+  // 重传定时器、RACK乱序定时器和TLP探测定时器，取最早到期的一个
+  if (timer_running_ && !outstanding_messages_.empty())
+    earliest(now_ms_ + current_RTO_ms_ - min(timer_, current_RTO_ms_));
+  if (rack_deadline_ms_.has_value())
+    earliest(*rack_deadline_ms_);
+  if (tlp_deadline_ms_.has_value())
+    earliest(*tlp_deadline_ms_);
+  return next;
+}
+
 void TCPSender::push(const TransmitFunction& transmit)
 {
-  // 计算有效窗口大小(将0窗口视为1进行窗口探测)
-  const uint16_t effective_window = window_size_ ? window_size_ : 1;
+  Batch batch;
+  push(batch);
+  for (const TCPSenderMessage& msg : batch) {
+    transmit(msg);
+  }
+}
+
+void TCPSender::tick(uint64_t ms_since_last_tick, const TransmitFunction& transmit)
+{
+  Batch batch;
+  tick(ms_since_last_tick, batch);
+  for (const TCPSenderMessage& msg : batch) {
+    transmit(msg);
+  }
+}
+
+void TCPSender::push(Batch& batch)
+{
+  // 先重传SACK计分板判定丢失的空洞（它们已经计入bytes_in_flight_，不占用新的窗口）
+  for (auto& seg : outstanding_messages_) {
+    if (seg.lost && !seg.sacked) {
+      retransmit(seg, batch);
+      seg.lost = false;
+    }
+  }
+
+  // 计算有效窗口大小(将0窗口视为1进行窗口探测)，同时不超过拥塞窗口
+  uint64_t effective_window = min<uint64_t>(window_size_ ? window_size_ : 1, cwnd_.value_or(UINT64_MAX));
+
+  // TCP Fast Open：SYN还可以带上最多一个MSS的数据
+  if (fast_open_ && !syn_sent_)
+    effective_window = max<uint64_t>(effective_window, 1 + mss_);
 
   // 持续发送直到窗口用尽或FIN已发送
+  bool sent_new = false;
   while (bytes_in_flight_ < effective_window && !fin_sent_) {
     TCPSenderMessage msg = make_empty_message();
 
@@ -33,15 +84,33 @@ void TCPSender::push(const TransmitFunction& transmit)
 
     // 计算考虑窗口和已发送数据后的可用负载空间
     const uint64_t remaining_capacity = effective_window - bytes_in_flight_;
+
+    // PLPMTUD：数据足够且窗口允许时，用一个比MSS更大的段探测路径（后面还有数据，所以不会带FIN）
+    const uint64_t probe_size = msg.SYN ? 0 : next_probe_size();
+    const bool probe = probe_size && reader().bytes_buffered() > probe_size && remaining_capacity >= probe_size;
+
     const size_t max_payload = min(remaining_capacity - msg.sequence_length(), // 考虑SYN/FIN占用
-                                  TCPConfig::MAX_PAYLOAD_SIZE);
+                                  probe ? probe_size : mss_);
 
-    // 从输入流填充负载，不超过计算出的最大容量
-    while (reader().bytes_buffered() && msg.payload.size() < max_payload) {
-      const string_view data = reader().peek().substr(0, max_payload - msg.payload.size());
-      msg.payload += data;
-      reader().pop(data.size());
+    // Nagle/Cork：不足MSS的小段先不发送，等待更多数据或ACK
+    if (!msg.SYN && hold_small_segment(min(reader().bytes_buffered(), max_payload)))
+      break;
+
+    // 限速：令牌用完时等待tick()补充
+    const bool paced = !msg.SYN && pacing_rate() > 0;
+    if (paced && pacing_credit_ <= 0)
+      break;
+
+    // 从输入流填充负载，不超过计算出的最大容量：先收集切片，再一次拼接
+    // （切片共享发送缓冲区，同一块内不复制；跨越多次写入时只复制一次，而不是每追加一块就复制一遍）
+    size_t payload_size = 0;
+    while (reader().bytes_buffered() && payload_size < max_payload) {
+      payload_parts_.push_back(reader().peek_slice().substr(0, max_payload - payload_size));
+      payload_size += payload_parts_.back().size();
+      reader().pop(payload_parts_.back().size());
     }
+    msg.payload = Slice::join(payload_parts_);
+    payload_parts_.clear();
 
     // 如果流已结束且窗口允许，设置FIN标志
     if (!fin_sent_ && reader().is_finished() && (remaining_capacity > msg.sequence_length())) {
@@ -53,11 +122,30 @@ void TCPSender::push(const TransmitFunction& transmit)
     if (msg.sequence_length() == 0)
       break;
 
-    // 传输段并更新跟踪状态
-    transmit(msg);
+    // ECN：新数据段声明ECN能力；降低拥塞窗口之后的第一个新数据段带上CWR
+    if (ecn_ && !msg.SYN && !msg.payload.empty()) {
+      msg.ecn = TCPSenderMessage::ECN_ECT0;
+      msg.CWR = cwr_pending_;
+      cwr_pending_ = false;
+    }
+
+    // 保存段并更新跟踪状态（deque尾部插入不会使已有元素的引用失效）
+    const uint64_t first_seqno = next_seqno_;
     next_seqno_ += msg.sequence_length();
     bytes_in_flight_ += msg.sequence_length();
-    outstanding_messages_.push(move(msg));
+    const bool app_limited = reader().bytes_buffered() == 0;
+    outstanding_messages_.push_back(
+      {move(msg), first_seqno, false, false, false, now_ms_, delivered_, app_limited, probe});
+    probe_in_flight_ |= probe;
+    batch.emplace_back(outstanding_messages_.back().msg);
+    sent_new = true;
+
+    if (paced) {
+      pacing_credit_ -= static_cast<int64_t>(outstanding_messages_.back().msg.sequence_length());
+      paced_segments_++;
+    } else {
+      burst_segments_++;
+    }
 
     // 如果定时器未运行，启动重传定时器
     if (!timer_running_) {
@@ -65,6 +153,26 @@ void TCPSender::push(const TransmitFunction& transmit)
       timer_ = 0;
     }
   }
+
+  if (sent_new)
+    last_active_ms_ = now_ms_;
+
+  // 发送了新数据：重新设置尾部丢失探测定时器
+  if (rack_tlp_ && sent_new)
+    arm_tlp();
+}
+
+bool TCPSender::hold_small_segment(uint64_t payload_size) const
+{
+  // 满MSS的段总是立即发送
+  if (payload_size >= mss_)
+    return false;
+
+  // 流已关闭且剩余数据都能放进这一段：带上FIN一起冲刷
+  if (input_.writer().is_closed() && payload_size == input_.reader().bytes_buffered())
+    return false;
+
+  return corked_ || (nagle_ && bytes_in_flight_ > 0);
 }
 
 TCPSenderMessage TCPSender::make_empty_message() const
@@ -72,9 +180,47 @@ TCPSenderMessage TCPSender::make_empty_message() const
   TCPSenderMessage msg;
   msg.seqno = isn_ + next_seqno_;
   msg.RST = input_.has_error();
+  if (timestamps_) {
+    msg.tsval = ts_clock();
+  }
   return msg;
 }
 
+void TCPSender::retransmit(OutstandingSegment& seg, Batch& batch)
+{
+  // 重传带上新的时间戳，对端回显后就能区分是哪一次发送被确认
+  if (timestamps_) {
+    seg.msg.tsval = ts_clock();
+  }
+  seg.retransmitted = true;
+  seg.sent_time_ms = now_ms_; // RACK按最近一次发送的时间判断
+  seg.msg.ecn = TCPSenderMessage::ECN_NOT_ECT; // 重传的段不能标记ECT（RFC 3168）
+  retransmitted_segments_++;
+  retransmitted_bytes_ += seg.msg.payload.size();
+  batch.emplace_back(seg.msg);
+}
+
+void TCPSender::update_rtt(uint64_t rtt_ms)
+{
+  // RFC 6298：SRTT和RTTVAR的指数加权平均
+  if (!srtt_ms_.has_value()) {
+    srtt_ms_ = rtt_ms;
+    rttvar_ms_ = rtt_ms / 2;
+  } else {
+    const uint64_t delta = *srtt_ms_ > rtt_ms ? *srtt_ms_ - rtt_ms : rtt_ms - *srtt_ms_;
+    rttvar_ms_ = (3 * rttvar_ms_ + delta) / 4;
+    srtt_ms_ = (7 * *srtt_ms_ + rtt_ms) / 8;
+  }
+}
+
+uint64_t TCPSender::base_RTO_ms() const
+{
+  // 只有协商了时间戳、有可靠的RTT样本时才自适应，否则使用初始RTO
+  if (!timestamps_ || !srtt_ms_.has_value())
+    return initial_RTO_ms_;
+  return max(*srtt_ms_ + max(uint64_t {1}, 4 * rttvar_ms_), MIN_RTO_MS);
+}
+
 void TCPSender::receive(const TCPReceiverMessage& msg)
 {
   // 处理错误状态
@@ -85,8 +231,11 @@ void TCPSender::receive(const TCPReceiverMessage& msg)
     return;
   }
 
-  // 更新接收方窗口大小
-  window_size_ = msg.window_size;
+  // 更新接收方窗口大小（按协商的缩放因子还原）
+  const uint32_t previous_window = window_size_;
+  window_size_ = static_cast<uint32_t>(msg.window_size) << window_shift_;
+  if (window_size_ == 0 && previous_window != 0)
+    zero_window_events_++;
 
   // 如果没有确认号，直接返回
   if (!msg.ackno)
@@ -100,58 +249,438 @@ void TCPSender::receive(const TCPReceiverMessage& msg)
     return; // 确认了未发送的数据
 
   // 忽略旧的确认
-  if (ack_abs <= ackno_)
+  if (ack_abs < ackno_)
     return;
 
-  bool acked = false;
+  const uint64_t flight_size = bytes_in_flight_;
+  const uint64_t delivered_before = delivered_;
+  bool acked = syn_data_rejected(ack_abs);
+  optional<uint64_t> rate_sample;
+  optional<uint64_t> rtt_sample;
   // 处理所有完全确认的段
   while (!outstanding_messages_.empty()) {
-    const auto& front_msg = outstanding_messages_.front();
-    const uint64_t segment_start = front_msg.seqno.unwrap(isn_, next_seqno_);
-    const uint64_t segment_end = segment_start + front_msg.sequence_length();
+    const auto& front = outstanding_messages_.front();
+    const uint64_t segment_end = front.first_seqno + front.msg.sequence_length();
 
     if (segment_end <= ack_abs) {
       // 段完全被确认，可以移除
       acked = true;
-      bytes_in_flight_ -= front_msg.sequence_length();
-      outstanding_messages_.pop();
+      bytes_in_flight_ -= front.msg.sequence_length();
+      delivered_ += front.msg.sequence_length();
+      if (front.probe) {
+        // 探测成功：路径可以承载这个大小
+        mss_ = probe_low_ = front.msg.payload.size();
+        probe_in_flight_ = false;
+      }
+      if (rack_tlp_ && !front.sacked)
+        rack_update(front);
+      if (!front.retransmitted) {
+        // 只用没有重传过的段，最终取最新被确认的那个（Karn）
+        if (const auto sample = delivery_rate_sample(front))
+          rate_sample = sample;
+        rtt_sample = now_ms_ - front.sent_time_ms;
+      }
+      outstanding_messages_.pop_front();
     } else {
       // 段部分被确认或未被确认，停止处理
       break;
     }
   }
 
+  // 没有时间戳选项时，每个ACK只取一个RTT样本：最新被确认、没有重传过的段（Karn算法）
+  // 一个累计确认覆盖的多个段的样本彼此相关，逐个采样会压低RTTVAR
+  if (rtt_sample.has_value() && !timestamps_)
+    update_rtt(*rtt_sample);
+
+  // 更新投递速率估计（EWMA，新样本权重1/8）
+  if (rate_sample.has_value()) {
+    delivery_rate_ = delivery_rate_ ? (7 * delivery_rate_ + *rate_sample) / 8 : *rate_sample;
+  }
+
+  // ECN：对端回显了拥塞标记，像丢包一样把拥塞窗口减半，每个窗口只响应一次（RFC 3168）
+  if (ecn_ && msg.ECE && ack_abs > ecn_recover_) {
+    cwnd_ = max(flight_size / 2, 2 * mss_);
+    ecn_recover_ = next_seqno_;
+    cwr_pending_ = true;
+  } else if (cwnd_.has_value() && acked) {
+    // 拥塞避免：每个RTT大约增加一个MSS
+    *cwnd_ += max(uint64_t {1}, mss_ * (delivered_ - delivered_before) / *cwnd_);
+  }
+
+  // 重复ACK：没有确认新数据，窗口也没有变化
+  if (!acked && ack_abs == ackno_ && !outstanding_messages_.empty() && window_size_ == previous_window)
+    duplicate_acks_++;
+
+  // 重复ACK也可能带来新的SACK信息
+  update_scoreboard(msg);
+
   // 更新已确认序列号
+  const uint64_t previous_ackno = ackno_;
   ackno_ = ack_abs;
 
+  // 时间戳回显了触发这个ACK的那次发送，即使段被重传过，RTT样本也没有歧义（RFC 7323）
+  // 只在确认号前移时采样；TSecr为0（对端没有回显）或晚于本地时钟（伪造或反射的段）都不是有效样本
+  if (acked && ack_abs > previous_ackno && timestamps_ && msg.tsecr.has_value() && *msg.tsecr != 0) {
+    const uint32_t rtt = ts_clock() - *msg.tsecr;
+    if (static_cast<int32_t>(rtt) >= 0)
+      update_rtt(rtt);
+  }
+
   // 如果有段被确认，重置定时器状态
   if (acked) {
     timer_ = 0;
-    current_RTO_ms_ = initial_RTO_ms_;
+    current_RTO_ms_ = base_RTO_ms();
     consecutive_retransmissions_ = 0;
     timer_running_ = !outstanding_messages_.empty();
   }
+
+  if (acked)
+    last_active_ms_ = now_ms_;
+  autotune_send_buffer();
+
+  // RACK：按最新送达段的发送时间判定丢失；新的累计确认结束这一轮尾部探测
+  if (rack_tlp_) {
+    rack_detect_loss();
+    if (acked) {
+      tlp_in_flight_ = false;
+      arm_tlp();
+    }
+  }
 }
 
-void TCPSender::tick(uint64_t ms_since_last_tick, const TransmitFunction& transmit)
+bool TCPSender::syn_data_rejected(uint64_t ack_abs)
+{
+  if (ack_abs != 1 || outstanding_messages_.empty())
+    return false;
+  auto& front = outstanding_messages_.front();
+  if (!front.msg.SYN || front.msg.sequence_length() <= 1)
+    return false;
+
+  // 对端没有接受SYN上的数据（没有Cookie或Cookie无效）：SYN本身已被确认，数据作为普通段重新发送
+  if (!front.retransmitted && !timestamps_)
+    update_rtt(now_ms_ - front.sent_time_ms);
+  front.msg.SYN = false;
+  front.msg.seqno = isn_ + 1;
+  front.first_seqno = 1;
+  front.lost = true;
+  bytes_in_flight_ -= 1;
+  delivered_ += 1;
+  return true;
+}
+
+optional<uint64_t> TCPSender::predict_ack(const TCPReceiverMessage& msg) const
 {
+  // SYN被确认之前、出错之后，以及窗口变化、SACK、ECE都要走完整的处理流程
+  if (ackno_ == 0 || input_.has_error() || msg.RST || msg.ECE || !msg.sack.empty() || !msg.ackno.has_value()
+      || (static_cast<uint32_t>(msg.window_size) << window_shift_) != window_size_)
+    return nullopt;
+
+  const uint64_t ack_abs = msg.ackno->unwrap(isn_, next_seqno_);
+  if (ack_abs < ackno_ || ack_abs > next_seqno_)
+    return nullopt;
+  return ack_abs - ackno_;
+}
+
+void TCPSender::tick(uint64_t ms_since_last_tick, Batch& batch)
+{
+  account_limited_time(ms_since_last_tick);
+  now_ms_ += ms_since_last_tick;
+
   // 只有在定时器运行时更新计时器
   if (timer_running_) {
     timer_ += ms_since_last_tick;
   }
 
+  // RACK：乱序窗口到期，判定丢失并重传
+  if (rack_deadline_ms_.has_value() && now_ms_ >= *rack_deadline_ms_) {
+    rack_detect_loss();
+    push(batch);
+  }
+
+  // TLP：探测超时先于RTO到期（发送探测后RTO重新计时）
+  if (tlp_deadline_ms_.has_value() && now_ms_ >= *tlp_deadline_ms_)
+    send_tail_loss_probe(batch);
+
   // 检查超时条件
   if (timer_running_ && timer_ >= current_RTO_ms_ && !outstanding_messages_.empty()) {
-    // 重传最早的未确认段
-    transmit(outstanding_messages_.front());
+    if (outstanding_messages_.front().probe) {
+      // 探测段超时：说明路径放不下这么大的段，不算拥塞，不做指数退避；拆分后重传
+      probe_failed(0);
+      push(batch);
+    } else {
+      // 重传最早的未确认段
+      retransmit(outstanding_messages_.front(), batch);
+
+      // 只有当窗口打开时应用指数退避
+      if (window_size_ > 0) {
+        consecutive_retransmissions_++;
+        current_RTO_ms_ *= 2;
+      }
+    }
+
+    // 重置定时器以准备下一次可能的重传；RTO之后不再做尾部探测
+    timer_ = 0;
+    tlp_deadline_ms_.reset();
+  }
+
+  // 空闲的连接缩回发送缓冲区
+  autotune_send_buffer();
 
-    // 只有当窗口打开时应用指数退避
-    if (window_size_ > 0) {
-      consecutive_retransmissions_++;
-      current_RTO_ms_ *= 2;
+  // 按速率补充令牌，并释放之前被限速挡住的段
+  if (pacing_rate() > 0) {
+    const int64_t refill = static_cast<int64_t>(pacing_rate() * ms_since_last_tick / 1000);
+    // 桶容量：一个tick的配额（至少两个MSS），空闲时不积攒更多的突发
+    pacing_credit_ = min(pacing_credit_ + refill, max(refill, static_cast<int64_t>(2 * mss_)));
+    push(batch);
+  }
+}
+
+void TCPSender::account_limited_time(uint64_t ms)
+{
+  // 握手完成之前不统计
+  if (ackno_ == 0)
+    return;
+
+  const bool unsent = reader().bytes_buffered() > 0 || (reader().is_finished() && !fin_sent_);
+  if (unsent && bytes_in_flight_ >= window_size_)
+    rwnd_limited_ms_ += ms;
+  else if (input_.writer().available_capacity() == 0)
+    sndbuf_limited_ms_ += ms;
+}
+
+void TCPSender::set_pacing(bool enabled, uint64_t rate)
+{
+  pacing_enabled_ = enabled;
+  configured_pacing_rate_ = rate;
+}
+
+void TCPSender::set_send_autotuning(bool enabled, uint64_t max_capacity)
+{
+  autotuning_ = enabled;
+  base_capacity_ = input_.capacity() - reservation_.bytes();
+  max_capacity_ = max(max_capacity, base_capacity_);
+}
+
+void TCPSender::autotune_send_buffer()
+{
+  if (!autotuning_)
+    return;
+
+  // 空闲：没有在途和待发送的数据，并且已经持续了一段时间
+  const bool idle = outstanding_messages_.empty() && input_.reader().bytes_buffered() == 0
+                    && now_ms_ - last_active_ms_ >= SEND_BUFFER_IDLE_MS;
+
+  uint64_t target = base_capacity_;
+  if (!idle) {
+    // 两倍带宽时延积：一半在途，一半在缓冲区里等待发送；活跃时不缩小
+    if (srtt_ms_.has_value())
+      target = max(target, 2 * delivery_rate_ * *srtt_ms_ / 1000);
+    target = max(target, input_.capacity());
+  }
+  target = min(target, max_capacity_);
+
+  // 超出配置大小的部分受全局预算限制
+  reservation_.resize(target - base_capacity_);
+  input_.set_capacity(base_capacity_ + reservation_.bytes());
+}
+
+void TCPSender::enable_mtu_probing(uint64_t max_mss)
+{
+  mtu_probing_ = max_mss > mss_;
+  probe_low_ = mss_;
+  probe_high_ = max_mss;
+}
+
+uint64_t TCPSender::max_payload_size() const
+{
+  return mtu_probing_ ? max(mss_, probe_high_) : mss_;
+}
+
+uint64_t TCPSender::next_probe_size() const
+{
+  if (!mtu_probing_ || probe_in_flight_ || probe_high_ < probe_low_ + PROBE_MIN_STEP)
+    return 0;
+  // 二分搜索：探测区间中点
+  return (probe_low_ + probe_high_ + 1) / 2;
+}
+
+void TCPSender::probe_failed(size_t index)
+{
+  const OutstandingSegment probe = move(outstanding_messages_[index]);
+  probe_high_ = probe.msg.payload.size() - 1;
+  probe_in_flight_ = false;
+
+  // 拆成当前MSS大小的段，标记为丢失，由push()重传
+  vector<OutstandingSegment> pieces;
+  for (uint64_t offset = 0; offset < probe.msg.payload.size(); offset += mss_) {
+    TCPSenderMessage piece;
+    piece.seqno = probe.msg.seqno + static_cast<uint32_t>(offset);
+    piece.payload = probe.msg.payload.substr(offset, mss_);
+    piece.RST = probe.msg.RST;
+    pieces.push_back({move(piece), probe.first_seqno + offset, false, true, true,
+                      probe.sent_time_ms, probe.delivered_at_send, probe.app_limited, false});
+  }
+
+  const auto pos = outstanding_messages_.erase(outstanding_messages_.begin() + static_cast<ptrdiff_t>(index));
+  outstanding_messages_.insert(pos, make_move_iterator(pieces.begin()), make_move_iterator(pieces.end()));
+}
+
+uint64_t TCPSender::pacing_rate() const
+{
+  if (!pacing_enabled_)
+    return 0;
+  // 没有配置速率时，按测得投递速率的两倍发送（还没有样本时不限速）
+  return configured_pacing_rate_ ? configured_pacing_rate_ : 2 * delivery_rate_;
+}
+
+optional<uint64_t> TCPSender::delivery_rate_sample(const OutstandingSegment& seg) const
+{
+  // SYN段不携带数据，不能反映路径的投递能力
+  if (seg.msg.SYN)
+    return nullopt;
+
+  // 时钟精度为毫秒，同一毫秒内的确认按1毫秒计算
+  const uint64_t interval_ms = max(now_ms_ - seg.sent_time_ms, uint64_t {1});
+  const uint64_t sample = (delivered_ - seg.delivered_at_send) * 1000 / interval_ms;
+
+  // 应用受限时测得的速率偏低，只在它超过当前估计时采用
+  if (seg.app_limited && sample <= delivery_rate_)
+    return nullopt;
+  return sample;
+}
+
+void TCPSender::update_scoreboard(const TCPReceiverMessage& msg)
+{
+  if (msg.sack.empty())
+    return;
+
+  // 标记被SACK块完整覆盖的段
+  for (const auto& block : msg.sack) {
+    const uint64_t begin = block.begin.unwrap(isn_, next_seqno_);
+    const uint64_t end = block.end.unwrap(isn_, next_seqno_);
+    if (begin >= end || end > next_seqno_)
+      continue; // 无效或超出已发送范围的块
+
+    for (auto& seg : outstanding_messages_) {
+      if (seg.first_seqno >= end)
+        break;
+      if (!seg.sacked && seg.first_seqno >= begin && seg.first_seqno + seg.msg.sequence_length() <= end) {
+        seg.sacked = true;
+        if (rack_tlp_)
+          rack_update(seg);
+      }
+    }
+  }
+
+  // 从高到低扫描：一个未被SACK的段之上若有足够多的段/字节已到达，就判定它丢失
+  uint64_t sacked_segments_above = 0;
+  uint64_t sacked_bytes_above = 0;
+  optional<size_t> lost_probe;
+  for (auto it = outstanding_messages_.rbegin(); it != outstanding_messages_.rend(); ++it) {
+    if (it->sacked) {
+      sacked_segments_above++;
+      sacked_bytes_above += it->msg.sequence_length();
+      continue;
+    }
+    if (!it->retransmitted && (sacked_segments_above >= DUP_THRESH
+                               || sacked_bytes_above > (DUP_THRESH - 1) * mss_)) {
+      it->lost = true;
+      if (it->probe)
+        lost_probe = outstanding_messages_.rend() - it - 1;
+    }
+  }
+
+  // 丢失的探测段不能按原大小重传
+  if (lost_probe.has_value())
+    probe_failed(*lost_probe);
+}
+
+void TCPSender::rack_update(const OutstandingSegment& seg)
+{
+  const uint64_t rtt = now_ms_ - seg.sent_time_ms;
+
+  // 重传过的段：RTT比最小RTT还短，说明确认的是更早的那次发送，样本不可用
+  if (seg.retransmitted && (!min_rtt_ms_.has_value() || rtt < *min_rtt_ms_))
+    return;
+  min_rtt_ms_ = min(min_rtt_ms_.value_or(rtt), rtt);
+
+  // 记录按发送时间最新的送达段，同一时刻发送的按结束序列号比较
+  const uint64_t end = seg.first_seqno + seg.msg.sequence_length();
+  if (seg.sent_time_ms > rack_xmit_ms_ || (seg.sent_time_ms == rack_xmit_ms_ && end > rack_end_seqno_)) {
+    rack_xmit_ms_ = seg.sent_time_ms;
+    rack_end_seqno_ = end;
+    rack_rtt_ms_ = rtt;
+  }
+}
+
+void TCPSender::rack_detect_loss()
+{
+  rack_deadline_ms_.reset();
+  if (!min_rtt_ms_.has_value())
+    return; // 还没有段送达
+
+  // 乱序窗口：最小RTT的四分之一，不超过SRTT
+  const uint64_t reo_wnd = min(*min_rtt_ms_ / 4, srtt_ms_.value_or(*min_rtt_ms_));
+
+  optional<size_t> lost_probe;
+  for (size_t i = 0; i < outstanding_messages_.size(); i++) {
+    auto& seg = outstanding_messages_[i];
+    if (seg.sacked || seg.lost)
+      continue;
+
+    // 只有比最新送达段更早发送的段才可能丢失
+    const uint64_t end = seg.first_seqno + seg.msg.sequence_length();
+    if (seg.sent_time_ms > rack_xmit_ms_ || (seg.sent_time_ms == rack_xmit_ms_ && end >= rack_end_seqno_))
+      continue;
+
+    const uint64_t deadline = seg.sent_time_ms + rack_rtt_ms_ + reo_wnd;
+    if (deadline <= now_ms_) {
+      seg.lost = true;
+      if (seg.probe)
+        lost_probe = i;
+    } else {
+      // 还在乱序窗口内：由定时器到期时再判断
+      rack_deadline_ms_ = min(rack_deadline_ms_.value_or(deadline), deadline);
     }
+  }
 
-    // 重置定时器以准备下一次可能的重传
+  // 丢失的探测段不能按原大小重传
+  if (lost_probe.has_value())
+    probe_failed(*lost_probe);
+}
+
+void TCPSender::arm_tlp()
+{
+  tlp_deadline_ms_.reset();
+  if (!rack_tlp_ || tlp_in_flight_ || !srtt_ms_.has_value() || outstanding_messages_.empty() || window_size_ == 0)
+    return;
+
+  // PTO = 2*SRTT；如果RTO会先到期，就不需要探测
+  const uint64_t pto = max(2 * *srtt_ms_, MIN_PTO_MS);
+  const uint64_t rto_remaining = current_RTO_ms_ - min(timer_, current_RTO_ms_);
+  if (pto < rto_remaining)
+    tlp_deadline_ms_ = now_ms_ + pto;
+}
+
+void TCPSender::send_tail_loss_probe(Batch& batch)
+{
+  tlp_deadline_ms_.reset();
+  tlp_in_flight_ = true;
+
+  // 优先用新数据探测；没有新数据可发时，重传最后一个未被SACK的段
+  const size_t sent = batch.size();
+  push(batch);
+  if (batch.size() == sent) {
+    for (auto it = outstanding_messages_.rbegin(); it != outstanding_messages_.rend(); ++it) {
+      if (!it->sacked) {
+        retransmit(*it, batch);
+        break;
+      }
+    }
+  }
+
+  if (batch.size() > sent) {
+    tail_loss_probes_++;
     timer_ = 0;
   }
-}
\ No newline at end of file
+}
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "send_buffer_budget.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
+#include <deque>
 #include <functional>
-#include <queue>
+#include <optional>
+#include <vector>
 
 class TCPSender
 {
@@ -21,6 +25,12 @@ public:
   /* Receive and process a TCPReceiverMessage from the peer's receiver */
   void receive( const TCPReceiverMessage& msg );
 
+  /*
+   * Header prediction: if the message is an unremarkable ACK (same window, no SACK blocks, no ECN echo, and an
+   * ackno within what has been sent), how many sequence numbers does it newly acknowledge? Empty otherwise.
+   */
+  std::optional<uint64_t> predict_ack( const TCPReceiverMessage& msg ) const;
+
   /* Type of the `transmit` function that the push and tick methods can use to send messages */
   using TransmitFunction = std::function<void( const TCPSenderMessage& )>;
 
@@ -30,15 +40,82 @@ public:
   /* Time has passed by the given # of milliseconds since the last time the tick() method was called */
   void tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit );
 
+  /*
+   * Batched versions of push and tick: append the segments to send to `batch` instead of calling
+   * a transmit function once per segment. The references point into the sender's outstanding
+   * segments and stay valid until the next call to receive().
+   */
+  using Batch = std::vector<std::reference_wrapper<const TCPSenderMessage>>;
+  void push( Batch& batch );
+  void tick( uint64_t ms_since_last_tick, Batch& batch );
+
   // Accessors
   uint64_t sequence_numbers_in_flight() const;  
   // For testing: how many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; 
   // For testing: how many consecutive retransmissions have happened?
+  uint64_t mss() const { return mss_; }                   // Effective maximum segment size
+  bool syn_sent() const { return syn_sent_; }             // Has our SYN gone out?
+  bool syn_acked() const { return ackno_ > 0; }           // Has the peer acknowledged our SYN?
+  std::optional<uint64_t> srtt_ms() const { return srtt_ms_; } // Smoothed RTT (empty until the first sample)
+  uint64_t current_RTO_ms() const { return current_RTO_ms_; }  // Retransmission timeout in effect
+  std::optional<uint64_t> next_timeout_ms() const; // Time until tick() has a timer to act on (empty if none runs)
+  uint64_t max_payload_size() const;                         // Largest payload that may be sent (including probes)
+  uint64_t pacing_rate() const;   // Pacing rate in effect, in bytes per second (0 if not pacing)
+  uint64_t delivery_rate() const { return delivery_rate_; } // Estimated delivery rate, in bytes per second
+  uint64_t paced_segments() const { return paced_segments_; } // New segments released by the pacer
+  uint64_t burst_segments() const { return burst_segments_; } // New segments sent without pacing
+  uint64_t tail_loss_probes() const { return tail_loss_probes_; } // Tail loss probes sent
+  std::optional<uint64_t> congestion_window() const { return cwnd_; } // Congestion window (empty until an ECE)
+  uint64_t window_size() const { return window_size_; }                // Peer's advertised window (scaled)
+  uint64_t retransmitted_segments() const { return retransmitted_segments_; } // Segments sent again
+  uint64_t retransmitted_bytes() const { return retransmitted_bytes_; }       // Payload bytes sent again
+  uint64_t duplicate_acks() const { return duplicate_acks_; }         // ACKs that acknowledged nothing new
+  uint64_t zero_window_events() const { return zero_window_events_; } // Times the peer's window closed
+  uint64_t rwnd_limited_ms() const { return rwnd_limited_ms_; }   // Time with data held back by the peer's window
+  uint64_t sndbuf_limited_ms() const { return sndbuf_limited_ms_; } // Time with a full send buffer otherwise
   const Writer& writer() const { return input_.writer(); }
   const Reader& reader() const { return input_.reader(); }
   Writer& writer() { return input_.writer(); }
 
+  /* Scale up the peer's advertised windows by this shift count (RFC 7323, agreed on the SYN exchange) */
+  void set_window_shift( uint8_t shift ) { window_shift_ = shift; }
+
+  /* Nagle's algorithm: hold back a sub-MSS segment while earlier data is still unacknowledged */
+  void set_nagle( bool enabled ) { nagle_ = enabled; }
+
+  /* Cork: hold back sub-MSS segments until uncorked (call push() afterwards to flush) */
+  void set_cork( bool corked ) { corked_ = corked; }
+
+  /* Pace new segments at `rate` bytes per second, or at twice the measured delivery rate if `rate` is 0 */
+  void set_pacing( bool enabled, uint64_t rate = 0 );
+
+  /* Stamp segments with the timestamps option (RFC 7323) and use the echoes to measure RTT */
+  void set_timestamps( bool enabled ) { timestamps_ = enabled; }
+
+  /* Largest payload per segment (the effective MSS, agreed on the SYN exchange) */
+  void set_mss( uint64_t mss ) { mss_ = mss; }
+
+  /* Packetization-layer path MTU discovery (RFC 4821): probe payload sizes up to `max_mss` */
+  void enable_mtu_probing( uint64_t max_mss );
+
+  /* RACK-TLP (RFC 8985): detect losses from the send time of the most recently delivered segment,
+   * and probe with the last segment when the tail of a flight goes unacknowledged */
+  void set_rack_tlp( bool enabled ) { rack_tlp_ = enabled; }
+
+  /* ECN (RFC 3168, agreed on the SYN exchange): mark new data ECN-capable, and halve the congestion window
+   * (at most once per window of data) when the peer echoes a congestion mark with ECE */
+  void set_ecn( bool enabled ) { ecn_ = enabled; }
+
+  /* Send-buffer autotuning: grow the outbound stream to twice the bandwidth-delay product (up to `max_capacity`,
+   * within the process-wide SendBufferBudget), and shrink it back to its configured capacity when idle */
+  void set_send_autotuning( bool enabled, uint64_t max_capacity );
+
+  /* TCP Fast Open (RFC 7413): the SYN carries up to one MSS of the data written before the first push() (which
+   * the caller may defer, but not for long: see TCPPeer::tick); if the SYN-ACK acknowledges only the SYN, the
+   * data is sent again right away */
+  void set_fast_open( bool enabled ) { fast_open_ = enabled; }
+
 private:
   Reader& reader() { return input_.reader(); }
 
@@ -50,12 +127,179 @@ private:
   bool fin_sent_{};                     //has the FIN flag been sent?
 
   /* window management */
-  uint16_t window_size_{ 1 };
-  // 窗口管理 - 接收方通告的窗口大小
-  // 16位：TCP标准窗口字段大小
+  uint32_t window_size_{ 1 };
+  // 窗口管理 - 接收方通告的窗口大小（已按窗口缩放因子左移）
+  // 32位：16位窗口字段左移最多14位
   // 初始值1：默认值，实际由对端ACK更新
   // 为0时视为1进行零窗口探测
 
+  uint8_t window_shift_ {};
+  // 对端窗口的缩放位数，SYN交换协商后设置；SYN段中的窗口不缩放
+
+  /* small segment coalescing */
+  bool nagle_ {};
+  // Nagle模式：有未确认数据时，不足MSS的数据先留在缓冲区里等待合并
+
+  bool corked_ {};
+  // Cork模式：不论是否有未确认数据，都只发送满MSS的段，直到取消cork
+  // 两种模式下FIN都会把剩余数据一起冲刷出去
+
+  bool hold_small_segment( uint64_t payload_size ) const;
+  // 判断这一段是否应该暂缓发送（Nagle/Cork）
+
+  /* TCP Fast Open */
+  bool fast_open_ {};
+  // SYN携带数据（此时还不知道对端的窗口，最多一个MSS）
+
+  bool syn_data_rejected(uint64_t ack_abs);
+  // SYN-ACK只确认了SYN：把SYN携带的数据改成普通段，标记为丢失以便立即重传
+
+  /* pacing */
+  bool pacing_enabled_ {};
+  // 是否启用按速率发送（令牌桶）
+
+  uint64_t configured_pacing_rate_ {};
+  // 配置的发送速率（字节/秒），为0时使用测得投递速率的两倍
+
+  int64_t pacing_credit_ { PACING_BURST };
+  // 令牌桶中的剩余字节数，tick()中按速率补充，发送新段时扣除（可以短暂为负）
+
+  uint64_t paced_segments_ {};
+  uint64_t burst_segments_ {};
+  // 统计：经过令牌桶发送的新段数 / 未限速直接发送的新段数
+
+  static constexpr int64_t PACING_BURST = 2 * TCPConfig::MAX_PAYLOAD_SIZE;
+  // 令牌桶的初始容量：两个默认大小的段；之后桶容量至少为两个当前MSS
+
+  /* timestamps and RTT estimation */
+  bool timestamps_ {};
+  // 是否在每个段上携带时间戳选项（SYN交换协商后确定）
+
+  std::optional<uint64_t> srtt_ms_ {};
+  uint64_t rttvar_ms_ {};
+  // 平滑RTT和RTT偏差（RFC 6298），只在时间戳回显的ACK上采样
+
+  static constexpr uint64_t MIN_RTO_MS = 200;
+  // 自适应RTO的下限
+
+  uint32_t ts_clock() const { return static_cast<uint32_t>( now_ms_ + 1 ); }
+  // 时间戳时钟（毫秒）从1开始，这样TSecr为0只表示对端没有回显，不会和真实的发送时刻混淆
+
+  void update_rtt( uint64_t rtt_ms );
+  uint64_t base_RTO_ms() const;
+  // 没有退避时的RTO：有RTT估计时为SRTT + 4*RTTVAR，否则为初始RTO
+
+  /* segment size */
+  uint64_t mss_ { TCPConfig::MAX_PAYLOAD_SIZE };
+  // 当前有效MSS（每段最大负载），SYN交换协商后设置，探测成功后增大
+
+  bool mtu_probing_ {};
+  uint64_t probe_low_ {};
+  uint64_t probe_high_ {};
+  // PLPMTUD二分搜索区间：probe_low_是已确认可用的大小（等于mss_），probe_high_是尚未排除的上限
+
+  bool probe_in_flight_ {};
+  // 是否有探测段还未被确认（同一时间只探测一个大小）
+
+  static constexpr uint64_t PROBE_MIN_STEP = 32;
+  // 搜索区间小于这个值时停止探测
+
+  uint64_t next_probe_size() const;
+  // 下一次探测的负载大小，0表示不探测
+
+  void probe_failed( size_t index );
+  // 探测段丢失：缩小上限，并把它拆成当前MSS大小的段等待重传
+
+  /* RACK-TLP */
+  bool rack_tlp_ {};
+  // 是否启用RACK-TLP（RFC 8985）
+
+  uint64_t rack_xmit_ms_ {};
+  uint64_t rack_end_seqno_ {};
+  uint64_t rack_rtt_ms_ {};
+  // 按发送时间最新的一个已送达（被确认或SACK）的段：发送时刻、结束序列号和它的RTT
+
+  std::optional<uint64_t> min_rtt_ms_ {};
+  // 最小RTT，乱序窗口为 min_rtt/4；为空表示还没有RACK样本
+
+  std::optional<uint64_t> rack_deadline_ms_ {};
+  // 乱序定时器：还在乱序窗口内的段，最早在这个时刻被判定丢失
+
+  std::optional<uint64_t> tlp_deadline_ms_ {};
+  // 尾部丢失探测的触发时刻（最后一次发送或ACK之后 2*SRTT）
+
+  bool tlp_in_flight_ {};
+  // 已经发出探测段、还没有收到新的ACK（每个尾部只探测一次）
+
+  uint64_t tail_loss_probes_ {};
+  // 统计：发出的尾部丢失探测次数
+
+  static constexpr uint64_t MIN_PTO_MS = 10;
+  // 探测超时的下限
+
+  /* ECN */
+  bool ecn_ {};
+  // 是否启用ECN：新数据段标记ECT(0)，收到ECE时降低拥塞窗口
+
+  std::optional<uint64_t> cwnd_ {};
+  // 拥塞窗口（字节）；收到第一个ECE之前为空，发送只受接收窗口限制
+
+  uint64_t ecn_recover_ {};
+  // 上一次响应ECE时的next_seqno_：确认号越过它之前不再响应（每个窗口只减半一次）
+
+  bool cwr_pending_ {};
+  // 已经降低拥塞窗口，下一个新数据段要带CWR通知对端
+
+  /* send-buffer autotuning */
+  bool autotuning_ {};
+  uint64_t base_capacity_ {};
+  uint64_t max_capacity_ {};
+  // 配置的发送缓冲区大小（自动调整的下限）和允许增长到的上限
+
+  SendBufferBudget::Reservation reservation_ {};
+  // 超出base_capacity_的部分，从进程全局的预算中申请，析构时归还
+
+  uint64_t last_active_ms_ {};
+  // 最近一次发送新数据或收到新确认的时刻
+
+  static constexpr uint64_t SEND_BUFFER_IDLE_MS = 1000;
+  // 没有在途和待发送的数据超过这么久，就把缓冲区缩回配置大小
+
+  void autotune_send_buffer();
+  // 按两倍带宽时延积调整输入流的容量（活跃时只增长，空闲时缩回）
+
+  /* statistics */
+  uint64_t retransmitted_segments_ {};
+  uint64_t retransmitted_bytes_ {};
+  // 重传的段数和负载字节数（包括超时、SACK/RACK判定丢失和尾部探测的重传）
+
+  uint64_t duplicate_acks_ {};
+  // 重复ACK：有数据在途时，确认号和窗口都没有变化的ACK
+
+  uint64_t zero_window_events_ {};
+  // 对端窗口从非零变为零的次数
+
+  uint64_t rwnd_limited_ms_ {};
+  uint64_t sndbuf_limited_ms_ {};
+  // 发送受限的时间（毫秒），在tick()中按上一次事件之后的状态累计：
+  // 有数据等待发送但在途数据已经占满对端窗口，算作受接收窗口限制；
+  // 否则发送缓冲区已满（应用无法继续写入），算作受发送缓冲区限制
+
+  void account_limited_time(uint64_t ms);
+
+  /* delivery rate estimation */
+  uint64_t now_ms_ {};
+  // tick()累计的当前时间（毫秒）
+
+  uint64_t delivered_ {};
+  // 累计被确认的序列号数量
+
+  uint64_t delivery_rate_ {};
+  // 投递速率的EWMA估计（字节/秒），为0表示还没有有效样本
+
+  std::vector<Slice> payload_parts_ {};
+  // 组装一个段的负载时从输入流取出的切片（复用，不必每个段都分配）
+
   uint64_t next_seqno_ {};
   // 下一个要使用的绝对序列号（相对isn_的偏移）
   // 64位：避免回绕，简化计算
@@ -104,10 +348,48 @@ private:
   // 用于测试和可能的连接放弃策略
 
   /*outstanding segments waiting for acknowledgment*/
-  std::queue<TCPSenderMessage> outstanding_messages_ {};
+  struct OutstandingSegment
+  {
+    TCPSenderMessage msg;
+    uint64_t first_seqno {};  // 段起始的绝对序列号
+    bool sacked {};           // 是否已被SACK块覆盖
+    bool lost {};             // 是否被计分板判定丢失、等待push()重传
+    bool retransmitted {};    // 是否已经重传过
+    uint64_t sent_time_ms {};       // 发送时刻（用于投递速率估计）
+    uint64_t delivered_at_send {};  // 发送时已累计确认的序列号数量
+    bool app_limited {};            // 发送时输入流已经没有更多数据（应用受限）
+    bool probe {};                  // 是否是PLPMTUD探测段
+  };
+
+  std::deque<OutstandingSegment> outstanding_messages_ {};
   // 等待确认的段队列（FIFO）
-  // 保存已发送但未被完全确认的TCPSenderMessage
+  // 保存已发送但未被完全确认的TCPSenderMessage，以及它的SACK计分板状态
   // 队头：最早发送的段，重传时优先处理
   // receive()中按序移除已确认的前缀段
   // 队列为空时停止计时器
+
+  static constexpr uint64_t DUP_THRESH = 3;
+  // SACK丢失判定阈值（RFC 6675）：
+  // 一个段之上有DUP_THRESH个段被SACK，或被SACK的字节数超过(DUP_THRESH-1)*MSS，就认为它丢失
+
+  void update_scoreboard( const TCPReceiverMessage& msg );
+  // 用SACK块标记已到达的段，并找出需要重传的空洞
+
+  void retransmit( OutstandingSegment& seg, Batch& batch );
+  // 重传一个未确认的段（更新时间戳，标记为已重传）
+
+  std::optional<uint64_t> delivery_rate_sample( const OutstandingSegment& seg ) const;
+  // 用一个刚被确认的段计算投递速率样本（字节/秒）；SYN段和偏低的应用受限样本不可用
+
+  void rack_update( const OutstandingSegment& seg );
+  // 一个段被确认或SACK：更新RACK的最新送达段和最小RTT
+
+  void rack_detect_loss();
+  // 比最新送达段更早发送、且超过 RTT + 乱序窗口 仍未送达的段判定为丢失
+
+  void arm_tlp();
+  // 有数据在途时设置探测定时器；探测超时不早于RTO时不设置（交给RTO处理）
+
+  void send_tail_loss_probe( Batch& batch );
+  // 优先发送新数据，没有新数据可发时重传最后一个未被SACK的段
 };
@@ -2,6 +2,7 @@
 
 #include <exception>
 #include <iostream>
+#include <string>
 
 using namespace std;
 
@@ -124,6 +125,29 @@ int main()
       test.execute( BytesBuffered { 0 } );
     }
 
+    {
+      ByteStreamTestHarness test { "peek gives the next piece, not everything", 1000 };
+
+      test.execute( Push { "cat" } );
+      test.execute( Push { "tac" } );
+      test.execute( PeekOnce { "cattac" } ); // short writes are gathered together
+
+      test.execute( Pop { 2 } );
+      test.execute( Push { "dog" } );
+      test.execute( PeekOnce { "ttacdog" } );
+
+      test.execute( Push { string( 300, 'x' ) } );
+      test.execute( BytesBuffered { 307 } );
+      test.execute( PeekOnce { "ttacdog" } ); // a long write is a piece of its own
+      test.execute( Peek { "ttacdog" + string( 300, 'x' ) } );
+
+      test.execute( Pop { 7 } );
+      test.execute( PeekOnce { string( 300, 'x' ) } );
+      test.execute( Push { "cow" } );
+      test.execute( Pop { 300 } );
+      test.execute( PeekOnce { "cow" } );
+    }
+
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
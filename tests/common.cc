@@ -89,6 +89,17 @@ string to_string( const TCPSenderMessage& msg )
   if ( msg.RST ) {
     o << " +RST";
   }
+  if ( msg.tsval.has_value() ) {
+    o << " TSval=" << msg.tsval.value();
+  }
+  if ( msg.CWR ) {
+    o << " +CWR";
+  }
+  if ( msg.ecn == TCPSenderMessage::ECN_ECT0 ) {
+    o << " ECT(0)";
+  } else if ( msg.ecn == TCPSenderMessage::ECN_CE ) {
+    o << " CE";
+  }
   o << ")";
   return o.str();
 }
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "helpers.hh"
+#include "tcp_demux.hh"
+
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+inline void expect( bool condition, const std::string& what )
+{
+  if ( not condition ) {
+    throw std::runtime_error( what );
+  }
+}
+
+// Two demultiplexers, a server at 10.0.0.1 and a client at 10.0.0.2, joined by queues of serialized datagrams.
+// The test decides when the datagrams are delivered.
+struct DemuxNetwork
+{
+  std::deque<std::string> to_server {};
+  std::deque<std::string> to_client {};
+  TCPConfig cfg;
+  TCPOverIPv4Demultiplexer server { cfg, writer( to_client ) };
+  TCPOverIPv4Demultiplexer client { cfg, writer( to_server ) };
+  const Address server_address { "10.0.0.1", 80 };
+  const uint32_t server_ip = server_address.ipv4_numeric();
+  const uint32_t client_ip = Address { "10.0.0.2", 0 }.ipv4_numeric();
+
+  explicit DemuxNetwork( const TCPConfig& config = {} ) : cfg( config ) {}
+
+  // Queue each datagram written, gathered into one string
+  static TCPOverIPv4Demultiplexer::DatagramWriter writer( std::deque<std::string>& queue )
+  {
+    return [&queue]( const std::vector<std::string_view>& buffers ) {
+      std::string datagram;
+      for ( const auto& buffer : buffers ) {
+        datagram.append( buffer );
+      }
+      queue.push_back( std::move( datagram ) );
+    };
+  }
+
+  // Deliver every datagram in `queue` to `host`
+  static void deliver( std::deque<std::string>& queue, TCPOverIPv4Demultiplexer& host )
+  {
+    while ( not queue.empty() ) {
+      InternetDatagram ip_dgram;
+      expect( parse( ip_dgram, std::vector<std::string> { std::move( queue.front() ) } ), "datagram should parse" );
+      queue.pop_front();
+      host.receive( std::move( ip_dgram ) );
+    }
+  }
+
+  // Deliver datagrams both ways until neither host has anything more to say
+  void run()
+  {
+    while ( not to_server.empty() or not to_client.empty() ) {
+      deliver( to_server, server );
+      deliver( to_client, client );
+    }
+  }
+
+  // The four-tuple of the connection from the client's `port` to the server's port 80, as seen at each end
+  FourTuple at_client( uint16_t port ) const { return { server_ip, 80, client_ip, port }; }
+  FourTuple at_server( uint16_t port ) const { return at_client( port ).reversed(); }
+};
@@ -0,0 +1,83 @@
+#include "peer_test_harness.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+TCPConfig delayed_ack_config( unsigned quick_acks )
+{
+  TCPConfig cfg;
+  cfg.delayed_ack = true;
+  cfg.quick_acks = quick_acks;
+  return cfg;
+}
+} // namespace
+
+int main()
+{
+  try {
+    {
+      PeerLink link { {}, {} };
+      link.connect();
+      link.client_sends( 4 );
+      for ( int i = 0; i < 4; i++ ) {
+        expect_replies( "without delayed ACKs, each segment", link.deliver_to_server(), 1 );
+      }
+    }
+
+    {
+      PeerLink link { {}, delayed_ack_config( 2 ) };
+      link.connect();
+      link.client_sends( 7 );
+      expect_replies( "first quick ACK", link.deliver_to_server(), 1 );
+      expect_replies( "second quick ACK", link.deliver_to_server(), 1 );
+      expect_replies( "first of two full-sized segments", link.deliver_to_server(), 0 );
+      expect_replies( "second of two full-sized segments", link.deliver_to_server(), 1 );
+      expect_replies( "third of four full-sized segments", link.deliver_to_server(), 0 );
+      expect_replies( "before the timeout", link.tick_server( 39 ), 0 );
+      expect_replies( "at the timeout", link.tick_server( 1 ), 1 );
+      expect_replies( "nothing left to acknowledge", link.tick_server( 100 ), 0 );
+      const Wrap32 ackno = link.server_to_client().back().receiver->ackno.value();
+      if ( ackno != link.client_to_server().front().sender->seqno ) {
+        throw runtime_error( "the delayed ACK did not acknowledge everything received" );
+      }
+
+      // a segment after a hole is ACKed right away (a duplicate ACK), and so is the one that fills the hole
+      link.client_to_server().push_back( move( link.client_to_server().front() ) );
+      link.client_to_server().pop_front();
+      expect_replies( "out-of-order segment", link.deliver_to_server(), 1 );
+      expect_replies( "segment that fills the hole", link.deliver_to_server(), 1 );
+    }
+
+    {
+      PeerLink link { {}, delayed_ack_config( 0 ) };
+      link.connect();
+      link.client_sends( 1 );
+      const Wrap32 next_seqno = link.client_to_server().front().sender->seqno + TCPConfig::MAX_PAYLOAD_SIZE;
+      expect_replies( "single segment", link.deliver_to_server(), 0 );
+
+      // data going the other way carries the acknowledgment
+      link.server().outbound_writer().push( "reply" );
+      link.server().push( link.to_client() );
+      expect_replies( "data segment", link.server_to_client().size(), 1 );
+      if ( link.server_to_client().back().receiver->ackno != next_seqno ) {
+        throw runtime_error( "the data segment did not acknowledge the segment received" );
+      }
+      expect_replies( "after the piggybacked ACK", link.tick_server( 100 ), 0 );
+
+      link.client().outbound_writer().close();
+      link.client().push( link.to_server() );
+      expect_replies( "FIN", link.deliver_to_server(), 1 );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
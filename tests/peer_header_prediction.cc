@@ -0,0 +1,56 @@
+#include "peer_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace {
+void expect_duplicate_acks( PeerLink& link, uint64_t expected )
+{
+  const uint64_t actual = link.server().stats().duplicate_acks;
+  if ( actual != expected ) {
+    throw runtime_error( "expected " + to_string( expected ) + " duplicate ACK(s) at the server, got "
+                         + to_string( actual ) );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    {
+      // The server has data in flight, so each data segment from the client, which acknowledges nothing new, is
+      // a duplicate ACK, whether header prediction takes it off the general path or not.
+      PeerLink link { {}, {} };
+      link.connect();
+      link.server().outbound_writer().push( "response" );
+      link.server().push( link.to_client() );
+      link.client_sends( 3 );
+
+      expect_replies( "in-order segment (predicted)", link.deliver_to_server(), 1 );
+      expect_duplicate_acks( link, 1 );
+
+      link.client_to_server().push_back( move( link.client_to_server().front() ) );
+      link.client_to_server().pop_front();
+      expect_replies( "out-of-order segment (general path)", link.deliver_to_server(), 1 );
+      expect_duplicate_acks( link, 2 );
+      expect_replies( "segment that fills the hole (general path)", link.deliver_to_server(), 1 );
+      expect_duplicate_acks( link, 3 );
+
+      if ( link.server().stats().segments_in_order != 2 or link.server().stats().segments_out_of_order != 1 ) {
+        throw runtime_error( "expected two segments in order and one out of order" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
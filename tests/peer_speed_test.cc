@@ -0,0 +1,125 @@
+#include "peer_test_harness.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+constexpr size_t NUM_SEGMENTS = 20000;
+constexpr size_t SEGMENT_SIZE = TCPConfig::MAX_PAYLOAD_SIZE;
+
+void report( string_view scenario, size_t segments, duration<double> test_duration )
+{
+  const double segments_per_second = static_cast<double>( segments ) / test_duration.count();
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "TCPPeer received " << scenario << " at " << fixed << setprecision( 2 ) << segments_per_second / 1e6
+       << " million segments/s.\n";
+  debug_output << "        TCPPeer " << scenario << ": " << fixed << setprecision( 2 ) << setw( 5 )
+               << segments_per_second / 1e6 << " million segments/s\n";
+
+  if ( segments_per_second < 1e5 ) {
+    throw runtime_error( "TCPPeer did not meet minimum speed of 100,000 segments/s." );
+  }
+}
+
+// The common case on the receiving side: the next data segment in order, with an ACK that says nothing new.
+void in_order_data()
+{
+  PeerLink link { {}, {} };
+  link.connect();
+
+  const Slice payload { string( SEGMENT_SIZE, 'x' ) };
+  const Wrap32 first_seqno = link.client().sender().make_empty_message().seqno;
+  const TCPReceiverMessage ack = link.client().receiver().send();
+  vector<TCPMessage> segments;
+  segments.reserve( NUM_SEGMENTS );
+  for ( size_t i = 0; i < NUM_SEGMENTS; i++ ) {
+    TCPSenderMessage data;
+    data.seqno = first_seqno + static_cast<uint32_t>( i * SEGMENT_SIZE );
+    data.payload = payload;
+    segments.push_back( { move( data ), TCPReceiverMessage { ack } } );
+  }
+
+  TCPPeer& server = link.server();
+  const auto discard = []( span<const TCPMessage> /*batch*/ ) {};
+  const auto start_time = steady_clock::now();
+  for ( auto& segment : segments ) {
+    server.receive( move( segment ), discard );
+    server.inbound_reader().pop( server.inbound_reader().bytes_buffered() );
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( server.inbound_reader().bytes_popped() != NUM_SEGMENTS * SEGMENT_SIZE ) {
+    throw runtime_error( "not all of the data was received" );
+  }
+  report( "in-order data", NUM_SEGMENTS, duration_cast<duration<double>>( stop_time - start_time ) );
+}
+
+// The common case on the sending side: a bare ACK of new data, which frees room for the next segment.
+void bare_acks()
+{
+  TCPConfig client_config;
+  client_config.send_capacity = 2 * NUM_SEGMENTS * SEGMENT_SIZE;
+  PeerLink link { client_config, {} };
+  link.connect();
+
+  TCPPeer& client = link.client();
+  const auto discard = []( span<const TCPMessage> /*batch*/ ) {};
+  const Wrap32 first_unacked = client.sender().make_empty_message().seqno;
+  client.outbound_writer().push( string( client_config.send_capacity, 'x' ) );
+  client.push( discard );
+  const uint64_t in_flight = client.sender().sequence_numbers_in_flight();
+
+  const TCPSenderMessage empty = link.server().sender().make_empty_message();
+  const TCPReceiverMessage window = link.server().receiver().send();
+  vector<TCPMessage> acks;
+  acks.reserve( NUM_SEGMENTS );
+  for ( size_t i = 0; i < NUM_SEGMENTS; i++ ) {
+    TCPReceiverMessage ack = window;
+    ack.ackno = first_unacked + static_cast<uint32_t>( ( i + 1 ) * SEGMENT_SIZE );
+    acks.push_back( { TCPSenderMessage { empty }, move( ack ) } );
+  }
+
+  const auto start_time = steady_clock::now();
+  for ( auto& ack : acks ) {
+    client.receive( move( ack ), discard );
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( client.sender().sequence_numbers_in_flight() != in_flight ) {
+    throw runtime_error( "the sender did not keep the window full" );
+  }
+  report( "bare ACKs", NUM_SEGMENTS, duration_cast<duration<double>>( stop_time - start_time ) );
+}
+
+void program_body()
+{
+  in_order_data();
+  bare_acks();
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+// Two TCPPeers joined by queues, so the test decides when (and whether) each message is delivered.
+class PeerLink
+{
+public:
+  PeerLink( const TCPConfig& client_config, const TCPConfig& server_config )
+    : client_( client_config ), server_( server_config )
+  {}
+
+  TCPPeer& client() { return client_; }
+  TCPPeer& server() { return server_; }
+
+  TCPPeer::TransmitFunction to_server()
+  {
+    return [this]( std::span<const TCPMessage> batch ) { enqueue( batch, to_server_ ); };
+  }
+  TCPPeer::TransmitFunction to_client()
+  {
+    return [this]( std::span<const TCPMessage> batch ) { enqueue( batch, to_client_ ); };
+  }
+
+  std::deque<TCPMessage>& client_to_server() { return to_server_; }
+  std::deque<TCPMessage>& server_to_client() { return to_client_; }
+
+  // Deliver the oldest message from the client, and return how many messages the server sent in reply.
+  size_t deliver_to_server()
+  {
+    if ( to_server_.empty() ) {
+      throw std::runtime_error( "no message from the client to deliver" );
+    }
+    const size_t before = to_client_.size();
+    TCPMessage msg = std::move( to_server_.front() );
+    to_server_.pop_front();
+    server_.receive( std::move( msg ), to_client() );
+    return to_client_.size() - before;
+  }
+
+  void deliver_all_to_client()
+  {
+    while ( not to_client_.empty() ) {
+      TCPMessage msg = std::move( to_client_.front() );
+      to_client_.pop_front();
+      client_.receive( std::move( msg ), to_server() );
+    }
+  }
+
+  size_t tick_server( uint64_t ms )
+  {
+    const size_t before = to_client_.size();
+    server_.tick( ms, to_client() );
+    return to_client_.size() - before;
+  }
+
+  void connect()
+  {
+    client_.push( to_server() );
+    deliver_to_server();
+    deliver_all_to_client();
+    while ( not to_server_.empty() ) {
+      deliver_to_server();
+    }
+    deliver_all_to_client();
+  }
+
+  // The client writes `segments` full-sized segments; they wait in the queue to the server.
+  void client_sends( size_t segments )
+  {
+    client_.outbound_writer().push( std::string( segments * TCPConfig::MAX_PAYLOAD_SIZE, 'x' ) );
+    client_.push( to_server() );
+    if ( to_server_.size() != segments ) {
+      throw std::runtime_error( "expected " + std::to_string( segments ) + " segments from the client, got "
+                                + std::to_string( to_server_.size() ) );
+    }
+  }
+
+private:
+  TCPPeer client_;
+  TCPPeer server_;
+  std::deque<TCPMessage> to_server_ {};
+  std::deque<TCPMessage> to_client_ {};
+
+  static void enqueue( std::span<const TCPMessage> batch, std::deque<TCPMessage>& queue )
+  {
+    for ( const auto& msg : batch ) {
+      queue.push_back( { TCPSenderMessage { msg.sender.get() }, TCPReceiverMessage { msg.receiver.get() } } );
+    }
+  }
+};
+
+inline void expect_replies( const std::string& what, size_t actual, size_t expected )
+{
+  if ( actual != expected ) {
+    throw std::runtime_error( what + ": expected " + std::to_string( expected )
+                              + " message(s) from the server, got " + std::to_string( actual ) );
+  }
+}
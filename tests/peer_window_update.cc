@@ -0,0 +1,54 @@
+#include "peer_test_harness.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      TCPConfig server_config;
+      server_config.recv_capacity = 4000;
+      server_config.sws_avoidance = true;
+      PeerLink link { {}, server_config };
+      link.connect();
+      link.client_sends( 4 );
+      for ( int i = 0; i < 4; i++ ) {
+        expect_replies( "data segment", link.deliver_to_server(), 1 );
+      }
+      if ( link.server_to_client().back().receiver->window_size != 0 ) {
+        throw runtime_error( "expected the window to be closed" );
+      }
+
+      Reader& inbound = link.server().inbound_reader();
+      inbound.pop( 500 );
+      expect_replies( "window opened by less than an MSS", link.tick_server( 10 ), 0 );
+      if ( link.server().stats().receive_window != 0 ) {
+        throw runtime_error( "expected the statistics to report the advertised window, not the free space" );
+      }
+      inbound.pop( 500 );
+      expect_replies( "window opened by an MSS", link.tick_server( 10 ), 1 );
+      if ( link.server_to_client().back().receiver->window_size != 1000 ) {
+        throw runtime_error( "expected the window update to advertise 1000 bytes" );
+      }
+      expect_replies( "same window again", link.tick_server( 10 ), 0 );
+      inbound.pop( 10 );
+      expect_replies( "a few more bytes read", link.tick_server( 10 ), 0 );
+      inbound.pop( 990 );
+      expect_replies( "window opened by another MSS", link.tick_server( 10 ), 1 );
+      if ( link.server_to_client().back().receiver->window_size != 2000 ) {
+        throw runtime_error( "expected the window update to advertise 2000 bytes" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
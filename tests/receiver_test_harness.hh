@@ -7,6 +7,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 template<std::derived_from<TestStep<Reassembler>> T>
 struct DirectReassemblerTest : public TestStep<TCPReceiver>
@@ -80,6 +81,158 @@ struct ExpectReset : public ExpectBool<TCPReceiver>
   bool value( const TCPReceiver& rs ) const override { return rs.send().RST; }
 };
 
+struct ExpectSack : public Expectation<TCPReceiver>
+{
+  std::vector<std::pair<Wrap32, Wrap32>> blocks_;
+
+  explicit ExpectSack( std::vector<std::pair<Wrap32, Wrap32>> blocks ) : blocks_( std::move( blocks ) ) {}
+
+  static std::string describe( const std::vector<std::pair<Wrap32, Wrap32>>& blocks )
+  {
+    std::ostringstream ss;
+    ss << "{";
+    for ( const auto& [begin, end] : blocks ) {
+      ss << " [" << to_string( begin ) << ", " << to_string( end ) << ")";
+    }
+    ss << " }";
+    return ss.str();
+  }
+
+  std::string description() const override { return "sack blocks = " + describe( blocks_ ); }
+
+  void execute( const TCPReceiver& rs ) const override
+  {
+    std::vector<std::pair<Wrap32, Wrap32>> actual;
+    for ( const auto& block : rs.send().sack ) {
+      actual.emplace_back( block.begin, block.end );
+    }
+    if ( actual != blocks_ ) {
+      throw ExpectationViolation( "should have had sack blocks = " + describe( blocks_ ) + ", but instead it was "
+                                  + describe( actual ) );
+    }
+  }
+};
+
+struct EnableSack : public Action<TCPReceiver>
+{
+  std::string description() const override { return "enable selective acknowledgments"; }
+  void execute( TCPReceiver& rs ) const override { rs.set_sack_enabled( true ); }
+};
+
+struct SetWindowShift : public Action<TCPReceiver>
+{
+  uint8_t shift_;
+  explicit SetWindowShift( uint8_t shift ) : shift_( shift ) {}
+  std::string description() const override { return "set window shift to " + std::to_string( shift_ ); }
+  void execute( TCPReceiver& rs ) const override { rs.set_window_shift( shift_ ); }
+};
+
+struct EnableTimestamps : public Action<TCPReceiver>
+{
+  std::string description() const override { return "enable timestamps"; }
+  void execute( TCPReceiver& rs ) const override { rs.set_timestamps( true ); }
+};
+
+struct ExpectTsecr : public ExpectNumber<TCPReceiver, std::optional<uint32_t>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "tsecr"; }
+  std::optional<uint32_t> value( const TCPReceiver& rs ) const override { return rs.send().tsecr; }
+};
+
+struct EnableECN : public Action<TCPReceiver>
+{
+  std::string description() const override { return "enable ECN"; }
+  void execute( TCPReceiver& rs ) const override { rs.set_ecn( true ); }
+};
+
+struct ExpectEce : public ExpectBool<TCPReceiver>
+{
+  using ExpectBool::ExpectBool;
+  std::string name() const override { return "ECE"; }
+
+  bool value( const TCPReceiver& rs ) const override { return rs.send().ECE; }
+};
+
+struct ExpectPawsRejected : public ExpectNumber<TCPReceiver, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "paws_rejected"; }
+  uint64_t value( const TCPReceiver& rs ) const override { return rs.paws_rejected(); }
+};
+
+struct EnableSwsAvoidance : public Action<TCPReceiver>
+{
+  uint64_t mss_;
+  explicit EnableSwsAvoidance( uint64_t mss ) : mss_( mss ) {}
+  std::string description() const override
+  {
+    return "avoid silly windows (MSS " + std::to_string( mss_ ) + ")";
+  }
+  void execute( TCPReceiver& rs ) const override { rs.set_sws_avoidance( true, mss_ ); }
+};
+
+struct EnableReceiveAutotuning : public Action<TCPReceiver>
+{
+  uint64_t max_capacity_;
+  explicit EnableReceiveAutotuning( uint64_t max_capacity ) : max_capacity_( max_capacity ) {}
+  std::string description() const override
+  {
+    return "autotune the receive buffer up to " + std::to_string( max_capacity_ ) + " bytes";
+  }
+  void execute( TCPReceiver& rs ) const override { rs.set_receive_autotuning( true, max_capacity_ ); }
+};
+
+struct Tick : public Action<TCPReceiver>
+{
+  uint64_t ms_;
+  explicit Tick( uint64_t ms ) : ms_( ms ) {}
+  std::string description() const override { return std::to_string( ms_ ) + " ms pass"; }
+  void execute( TCPReceiver& rs ) const override { rs.tick( ms_ ); }
+};
+
+struct ExpectCapacity : public ExpectNumber<TCPReceiver, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "writer().capacity()"; }
+  uint64_t value( const TCPReceiver& rs ) const override { return rs.writer().capacity(); }
+};
+
+struct ExpectRtt : public ExpectNumber<TCPReceiver, std::optional<uint64_t>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rtt_ms"; }
+  std::optional<uint64_t> value( const TCPReceiver& rs ) const override { return rs.rtt_ms(); }
+};
+
+struct ExpectInOrderSegments : public ExpectNumber<TCPReceiver, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "in_order_segments"; }
+  uint64_t value( const TCPReceiver& rs ) const override { return rs.in_order_segments(); }
+};
+
+struct ExpectOutOfOrderSegments : public ExpectNumber<TCPReceiver, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "out_of_order_segments"; }
+  uint64_t value( const TCPReceiver& rs ) const override { return rs.out_of_order_segments(); }
+};
+
+struct ExpectDuplicateSegments : public ExpectNumber<TCPReceiver, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "duplicate_segments"; }
+  uint64_t value( const TCPReceiver& rs ) const override { return rs.duplicate_segments(); }
+};
+
+struct ExpectBeyondWindowSegments : public ExpectNumber<TCPReceiver, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "beyond_window_segments"; }
+  uint64_t value( const TCPReceiver& rs ) const override { return rs.beyond_window_segments(); }
+};
+
 struct ExpectAcknoBetween : public Expectation<TCPReceiver>
 {
   Wrap32 isn_;
@@ -119,6 +272,7 @@ struct SegmentArrives : public Action<TCPReceiver>
 {
   TCPSenderMessage msg_ {};
   HasAckno ackno_expected_ { true };
+  bool ack_sent_ { true };
 
   SegmentArrives& with_syn()
   {
@@ -152,6 +306,31 @@ struct SegmentArrives : public Action<TCPReceiver>
     return *this;
   }
 
+  SegmentArrives& with_tsval( uint32_t tsval )
+  {
+    msg_.tsval = tsval;
+    return *this;
+  }
+
+  SegmentArrives& with_cwr()
+  {
+    msg_.CWR = true;
+    return *this;
+  }
+
+  SegmentArrives& with_ecn( uint8_t ecn )
+  {
+    msg_.ecn = ecn;
+    return *this;
+  }
+
+  // The receiver holds back its ACK for this segment (as with delayed ACKs)
+  SegmentArrives& without_ack_sent()
+  {
+    ack_sent_ = false;
+    return *this;
+  }
+
   SegmentArrives& without_ackno()
   {
     ackno_expected_ = HasAckno { false };
@@ -161,6 +340,9 @@ struct SegmentArrives : public Action<TCPReceiver>
   void execute( TCPReceiver& rs ) const override
   {
     rs.receive( msg_ );
+    if ( ack_sent_ ) {
+      rs.sent( rs.send() );
+    }
     ackno_expected_.execute( rs );
   }
 
@@ -0,0 +1,96 @@
+#include "byte_stream_test_harness.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+constexpr uint32_t isn = 5000;
+constexpr size_t cap = 4000;
+
+// One round trip of a sender limited by the receive window: 10 ms after the window was advertised, it
+// arrives as four 1000-byte segments, and the application reads each segment right away. The receiver
+// gets an RTT sample from each window, and sees the application read 4000 bytes per RTT.
+void window_limited_round( TCPReceiverTestHarness& test, uint32_t round )
+{
+  test.execute( Tick { 10 } );
+  for ( uint32_t i = 0; i < 4; i++ ) {
+    const uint32_t offset = 4000 * round + 1000 * i;
+    test.execute( SegmentArrives {}.with_seqno( isn + 1 + offset ).with_data( string( 1000, 'x' ) ) );
+    test.execute( ReadAll { string( 1000, 'x' ) } );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    {
+      TCPReceiverTestHarness test { "Fixed capacity without autotuning", cap };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      for ( uint32_t round = 0; round < 3; round++ ) {
+        window_limited_round( test, round );
+      }
+      test.execute( ExpectRtt { nullopt } );
+      test.execute( ExpectCapacity { cap } );
+      test.execute( ExpectWindow { cap } );
+    }
+
+    {
+      TCPReceiverTestHarness test { "Window grows to twice what the application reads per RTT", cap };
+      test.execute( EnableReceiveAutotuning { 100000 } );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      window_limited_round( test, 0 );
+      test.execute( ExpectRtt { 10 } );
+      window_limited_round( test, 1 );
+      test.execute( ExpectCapacity { cap } );
+      window_limited_round( test, 2 );
+      test.execute( ExpectRtt { 10 } );
+      test.execute( ExpectCapacity { 2 * cap } );
+      test.execute( ExpectWindow { 2 * cap } );
+
+      // reading at the same rate doesn't grow it further, and an idle round trip doesn't shrink it
+      test.execute( Tick { 10 } );
+      test.execute( Tick { 10 } );
+      test.execute( ExpectCapacity { 2 * cap } );
+    }
+
+    {
+      TCPReceiverTestHarness test { "Window stops growing at the maximum", cap };
+      test.execute( EnableReceiveAutotuning { 6000 } );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      for ( uint32_t round = 0; round < 3; round++ ) {
+        window_limited_round( test, round );
+      }
+      test.execute( ExpectCapacity { 6000 } );
+      test.execute( ExpectWindow { 6000 } );
+    }
+
+    {
+      TCPReceiverTestHarness test { "Slow reader: window stays at its configured size", cap };
+      test.execute( EnableReceiveAutotuning { 100000 } );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( Tick { 10 } );
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        test.execute( SegmentArrives {}.with_seqno( isn + 1 + 1000 * i ).with_data( string( 1000, 'x' ) ) );
+      }
+      test.execute( ExpectRtt { 10 } );
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        test.execute( Tick { 10 } );
+        test.execute( Pop { 1000 } );
+      }
+      test.execute( Tick { 10 } );
+      test.execute( ExpectCapacity { cap } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#include "byte_stream_test_harness.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      const size_t cap = 4000;
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "Segments are classified by where they fall in the window", cap };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ijkl" ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 3 ).with_data( "cdef" ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 3 ).with_data( "cd" ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 + cap ).with_data( "x" ) );
+      test.execute( ExpectInOrderSegments { 2 } );
+      test.execute( ExpectOutOfOrderSegments { 1 } );
+      test.execute( ExpectDuplicateSegments { 2 } );
+      test.execute( ExpectBeyondWindowSegments { 1 } );
+      test.execute( ExpectAckno { Wrap32 { isn + 7 } } );
+      test.execute( ExpectWindow { cap - 6 } );
+      test.execute( ReadAll { "abcdef" } );
+    }
+
+    {
+      const size_t cap = 4;
+      const uint32_t isn = 100;
+      TCPReceiverTestHarness test { "Duplicates and out-of-window data don't change what is acknowledged", cap };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectWindow { 0 } );
+
+      // a zero-window probe and a retransmission storm of the data already received
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "e" ) );
+      for ( int i = 0; i < 10; i++ ) {
+        test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      }
+      test.execute( ExpectAckno { Wrap32 { isn + 5 } } );
+      test.execute( ExpectWindow { 0 } );
+      test.execute( ExpectDuplicateSegments { 10 } );
+      test.execute( ExpectBeyondWindowSegments { 1 } );
+      test.execute( ExpectInOrderSegments { 1 } );
+
+      // a FIN takes no room in the buffer, so it is accepted at the right edge of a closed window
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_fin() );
+      test.execute( ExpectAckno { Wrap32 { isn + 6 } } );
+      test.execute( ExpectInOrderSegments { 2 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_fin() );
+      test.execute( ExpectDuplicateSegments { 11 } );
+      test.execute( ExpectAckno { Wrap32 { isn + 6 } } );
+      test.execute( ReadAll { "abcd" } );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      const size_t cap = 4000;
+      const uint32_t isn = 5;
+      TCPReceiverTestHarness test { "Bare ACKs are not counted as data segments", cap };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ) );
+      test.execute( ExpectInOrderSegments { 0 } );
+      test.execute( ExpectDuplicateSegments { 0 } );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ).with_data( "hello" ) );
+      test.execute( ExpectInOrderSegments { 1 } );
+      test.execute( ExpectAckno { Wrap32 { isn + 6 } } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+#include "byte_stream_test_harness.hh"
+#include "random.hh"
+#include "reassembler_test_harness.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+constexpr uint8_t ECT0 = TCPSenderMessage::ECN_ECT0;
+constexpr uint8_t CE = TCPSenderMessage::ECN_CE;
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "no echo unless enabled", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_ecn( CE ) );
+      test.execute( ExpectEce { false } );
+      test.execute( ReadAll { "abcd" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "echo a congestion mark until CWR", 4000 };
+      test.execute( EnableECN {} );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectEce { false } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_ecn( ECT0 ) );
+      test.execute( ExpectEce { false } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ).with_ecn( CE ) );
+      test.execute( ExpectEce { true } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ijkl" ).with_ecn( ECT0 ) );
+      test.execute( ExpectEce { true } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 13 ).with_data( "mnop" ).with_cwr() );
+      test.execute( ExpectEce { false } );
+      test.execute( ExpectAckno { Wrap32 { isn + 17 } } );
+      test.execute( ReadAll { "abcdefghijklmnop" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "a new mark on the CWR segment is echoed again", 4000 };
+      test.execute( EnableECN {} );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ).with_ecn( CE ) );
+      test.execute( ExpectEce { true } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ).with_cwr().with_ecn( CE ) );
+      test.execute( ExpectEce { true } );
+      test.execute( ReadAll { "abcdefgh" } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
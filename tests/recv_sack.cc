@@ -0,0 +1,84 @@
+#include "byte_stream_test_harness.hh"
+#include "random.hh"
+#include "reassembler_test_harness.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "no sack blocks unless enabled", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSack { {} } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "one hole reported", 4000 };
+      test.execute( EnableSack {} );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectSack { {} } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSack { { { Wrap32 { isn + 5 }, Wrap32 { isn + 9 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ijkl" ) );
+      test.execute( ExpectSack { { { Wrap32 { isn + 5 }, Wrap32 { isn + 13 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 13 } } );
+      test.execute( ExpectSack { {} } );
+      test.execute( ReadAll { "abcdefghijkl" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "most recent block first, then highest", 4000 };
+      test.execute( EnableSack {} );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 11 ).with_data( "kl" ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 21 ).with_data( "uv" ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "ef" ) );
+      test.execute( ExpectSack { { { Wrap32 { isn + 5 }, Wrap32 { isn + 7 } },
+                                   { Wrap32 { isn + 21 }, Wrap32 { isn + 23 } },
+                                   { Wrap32 { isn + 11 }, Wrap32 { isn + 13 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 13 ).with_data( "mn" ) );
+      test.execute( ExpectSack { { { Wrap32 { isn + 11 }, Wrap32 { isn + 15 } },
+                                   { Wrap32 { isn + 21 }, Wrap32 { isn + 23 } },
+                                   { Wrap32 { isn + 5 }, Wrap32 { isn + 7 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 7 } } );
+      test.execute( ExpectSack { { { Wrap32 { isn + 11 }, Wrap32 { isn + 15 } },
+                                   { Wrap32 { isn + 21 }, Wrap32 { isn + 23 } } } } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "at most four blocks", 4000 };
+      test.execute( EnableSack {} );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      for ( uint32_t i = 0; i < 6; ++i ) {
+        test.execute( SegmentArrives {}.with_seqno( isn + 3 + 4 * i ).with_data( "xy" ) );
+      }
+      test.execute( ExpectSack { { { Wrap32 { isn + 23 }, Wrap32 { isn + 25 } },
+                                   { Wrap32 { isn + 19 }, Wrap32 { isn + 21 } },
+                                   { Wrap32 { isn + 15 }, Wrap32 { isn + 17 } },
+                                   { Wrap32 { isn + 11 }, Wrap32 { isn + 13 } } } } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+#include "byte_stream_test_harness.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      const size_t cap = 4000;
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "Window opens in MSS-sized steps as a slow reader drains the buffer", cap };
+      test.execute( EnableSwsAvoidance { 1000 } );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectWindow { cap } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( cap, 'a' ) ) );
+      test.execute( ExpectWindow { 0 } );
+      test.execute( Pop { 500 } );
+      test.execute( ExpectWindow { 0 } );
+      test.execute( Pop { 499 } );
+      test.execute( ExpectWindow { 0 } );
+      test.execute( Pop { 1 } );
+      test.execute( ExpectWindow { 0 } ); // the right edge moves on the receiver's next tick or segment
+      test.execute( Tick { 0 } );
+      test.execute( ExpectWindow { 1000 } );
+
+      // the right edge stays put until it can move by another MSS
+      test.execute( Pop { 300 } );
+      test.execute( ExpectWindow { 1000 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 + cap ).with_data( string( 600, 'b' ) ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 1 + cap + 600 } } );
+      test.execute( ExpectWindow { 400 } );
+      test.execute( Pop { 700 } );
+      test.execute( Tick { 0 } );
+      test.execute( ExpectWindow { 1400 } );
+    }
+
+    {
+      const size_t cap = 1000;
+      const uint32_t isn = 1;
+      TCPReceiverTestHarness test { "With a small buffer, half the buffer is enough to open the window", cap };
+      test.execute( EnableSwsAvoidance { 1460 } );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( cap, 'a' ) ) );
+      test.execute( ExpectWindow { 0 } );
+      test.execute( Pop { 499 } );
+      test.execute( ExpectWindow { 0 } );
+      test.execute( Pop { 1 } );
+      test.execute( Tick { 0 } );
+      test.execute( ExpectWindow { 500 } );
+    }
+
+    {
+      const size_t cap = 4000;
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "Asking for the window does not move it", cap };
+      test.execute( EnableSwsAvoidance { 1000 } );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( cap, 'a' ) ) );
+      test.execute( Pop { 1000 } );
+      test.execute( ExpectWindow { 0 } );
+      test.execute( ExpectWindow { 0 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 + cap ) ); // a pure ACK is the next event
+      test.execute( ExpectWindow { 1000 } );
+      test.execute( ExpectWindow { 1000 } );
+    }
+
+    {
+      const size_t cap = 4000;
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "Without SWS avoidance, every byte read opens the window", cap };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( cap, 'a' ) ) );
+      test.execute( ExpectWindow { 0 } );
+      test.execute( Pop { 1 } );
+      test.execute( ExpectWindow { 1 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -106,6 +106,20 @@ int main()
       test.execute( BytesPending( 0 ) );
     }
 
+    {
+      const size_t cap = 4'000'000;
+      const uint32_t isn = 23452;
+      TCPReceiverTestHarness test { "window is scaled down by the shift count", cap };
+      test.execute( SetWindowShift { 7 } );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectWindow { cap >> 7 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( 1000, 'a' ) ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 1001 } } );
+      test.execute( ExpectWindow { ( cap - 1000 ) >> 7 } );
+      test.execute( SetWindowShift { 0 } );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return 1;
@@ -0,0 +1,258 @@
+#include "helpers.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_receiver.hh"
+#include "tcp_sender.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Count the bytes in large allocations. A copy of a received payload needs an allocation at least
+// as large as the payload, while the bookkeeping along the way (deque nodes, map nodes, vectors
+// of buffers) stays well below that size.
+namespace {
+constexpr size_t MIN_COPY_SIZE = 1024;
+size_t large_allocation_bytes = 0; // NOLINT(*-avoid-non-const-global-variables)
+} // namespace
+
+void* operator new( size_t size )
+{
+  if ( size >= MIN_COPY_SIZE ) {
+    large_allocation_bytes += size;
+  }
+  if ( void* ptr = malloc( size ) ) { // NOLINT(*-no-malloc)
+    return ptr;
+  }
+  throw bad_alloc {};
+}
+
+void* operator new[]( size_t size )
+{
+  return operator new( size );
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+void operator delete( void* ptr, size_t /*size*/ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+void operator delete[]( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+void operator delete[]( void* ptr, size_t /*size*/ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+namespace {
+constexpr uint32_t ISN = 1000;
+constexpr size_t IP_AND_TCP_HEADERS = 40;
+constexpr size_t TYPICAL_MTU = 1500;
+
+struct Segment
+{
+  uint64_t stream_index;
+  string data;
+};
+
+// A datagram split into buffers the way TCPOverIPv4OverTunFdAdapter::read() receives it:
+// the IPv4 header, the TCP header, up to a typical MTU's worth of the rest, and anything beyond that.
+vector<string> datagram_buffers( TCPOverIPv4Adapter& remote, const Segment& segment, bool timestamps )
+{
+  TCPSenderMessage sender_message;
+  sender_message.seqno = Wrap32 { ISN } + static_cast<uint32_t>( 1 + segment.stream_index );
+  sender_message.payload = segment.data;
+  if ( timestamps ) {
+    sender_message.tsval = 1;
+  }
+  TCPReceiverMessage receiver_message;
+  receiver_message.window_size = UINT16_MAX;
+
+  const string datagram
+    = concat( serialize( remote.wrap_tcp_in_ip( { move( sender_message ), move( receiver_message ) } ) ) );
+  return { datagram.substr( 0, IPv4Header::LENGTH ),
+           datagram.substr( IPv4Header::LENGTH, TCPSegment::HEADER_LENGTH ),
+           datagram.substr( IP_AND_TCP_HEADERS, TYPICAL_MTU - IP_AND_TCP_HEADERS ),
+           datagram.size() > TYPICAL_MTU ? datagram.substr( TYPICAL_MTU ) : string {} };
+}
+
+// Deliver the segments, in the given order, from the wire through the TCPReceiver to the inbound stream.
+// Returns the number of payload copies made per received byte.
+double copies_per_byte( const vector<Segment>& segments, bool timestamps )
+{
+  TCPOverIPv4Adapter local;
+  local.config_mut().source = Address { "10.144.0.1", 4000 };
+  local.config_mut().destination = Address { "10.144.0.2", 5000 };
+  TCPOverIPv4Adapter remote;
+  remote.config_mut().source = local.config().destination;
+  remote.config_mut().destination = local.config().source;
+
+  TCPReceiver receiver { Reassembler { ByteStream { TCPConfig::DEFAULT_CAPACITY } } };
+  TCPSenderMessage syn;
+  syn.seqno = Wrap32 { ISN };
+  syn.SYN = true;
+  receiver.receive( move( syn ) );
+
+  string expected;
+  vector<vector<string>> datagrams;
+  for ( const auto& segment : segments ) {
+    datagrams.push_back( datagram_buffers( remote, segment, timestamps ) );
+    expected.resize( max( expected.size(), segment.stream_index + segment.data.size() ) );
+    expected.replace( segment.stream_index, segment.data.size(), segment.data );
+  }
+  string received;
+  received.reserve( expected.size() );
+
+  const size_t before = large_allocation_bytes;
+  for ( auto& buffers : datagrams ) {
+    InternetDatagram ip_dgram;
+    if ( not parse( ip_dgram, move( buffers ) ) ) {
+      throw runtime_error( "could not parse datagram" );
+    }
+    optional<TCPMessage> message = local.unwrap_tcp_in_ip( move( ip_dgram ) );
+    if ( not message.has_value() ) {
+      throw runtime_error( "could not unwrap TCP segment" );
+    }
+    receiver.receive( message->sender.release() );
+
+    Reader& reader = receiver.reader();
+    while ( reader.bytes_buffered() ) {
+      received.append( reader.peek() );
+      reader.pop( reader.peek().size() );
+    }
+  }
+  const size_t copied = large_allocation_bytes - before;
+
+  if ( received != expected ) {
+    throw runtime_error( "received data does not match what was sent" );
+  }
+  return static_cast<double>( copied ) / static_cast<double>( received.size() );
+}
+
+void expect_copies( const string& name, double copies, double max_copies )
+{
+  constexpr double slack = 0.01; // a copied string's allocation also holds its terminating NUL
+  if ( copies > max_copies + slack ) {
+    throw runtime_error( name + ": " + to_string( copies ) + " payload copies per received byte (expected at most "
+                         + to_string( max_copies ) + ")" );
+  }
+  cerr << "Test \"" << name << "\": " << copies << " copies per received byte\n";
+}
+
+// Wrap one segment in a datagram, as a sender does, and return the payload copies per byte this makes.
+double copies_per_byte_sent( size_t payload_size )
+{
+  TCPOverIPv4Adapter remote;
+  remote.config_mut().source = Address { "10.144.0.2", 5000 };
+  remote.config_mut().destination = Address { "10.144.0.1", 4000 };
+
+  TCPMessage message;
+  message.sender->seqno = Wrap32 { ISN };
+  message.sender->payload = string( payload_size, 'x' );
+  message.sender->tsval = 1;
+
+  const size_t before = large_allocation_bytes;
+  const InternetDatagram ip_dgram = remote.wrap_tcp_in_ip( message );
+  const size_t copied = large_allocation_bytes - before;
+  if ( ip_dgram.payload.back().get().data() != message.sender->payload.view().data() ) {
+    throw runtime_error( "datagram should borrow the segment's payload" );
+  }
+  return static_cast<double>( copied ) / static_cast<double>( payload_size );
+}
+
+// Write `total` bytes to a TCPSender in writes of `write_size` bytes, and return the payload copies per byte
+// made while cutting them into segments of `mss` bytes.
+double copies_per_byte_segmented( size_t total, size_t write_size, size_t mss )
+{
+  TCPSender sender { ByteStream { TCPConfig::DEFAULT_CAPACITY }, Wrap32 { ISN }, TCPConfig::TIMEOUT_DFLT };
+  sender.set_mss( mss );
+  TCPSender::Batch batch;
+  sender.push( batch );
+  TCPReceiverMessage ack;
+  ack.ackno = Wrap32 { ISN } + 1;
+  ack.window_size = UINT16_MAX;
+  sender.receive( ack );
+  batch.clear();
+
+  for ( size_t written = 0; written < total; written += write_size ) {
+    sender.writer().push( string( min( write_size, total - written ), 'x' ) );
+  }
+
+  const size_t before = large_allocation_bytes;
+  sender.push( batch );
+  const size_t copied = large_allocation_bytes - before;
+
+  size_t sent = 0;
+  for ( const TCPSenderMessage& msg : batch ) {
+    sent += msg.payload.size();
+  }
+  if ( sent != total ) {
+    throw runtime_error( "sender should send everything written" );
+  }
+  return static_cast<double>( copied ) / static_cast<double>( total );
+}
+
+vector<Segment> split( size_t total, size_t segment_size )
+{
+  vector<Segment> segments;
+  for ( size_t i = 0; i < total; i += segment_size ) {
+    string data;
+    for ( size_t j = i; j < min( i + segment_size, total ); j++ ) {
+      data.push_back( static_cast<char>( 'a' + j % 26 ) );
+    }
+    segments.push_back( { i, move( data ) } );
+  }
+  return segments;
+}
+} // namespace
+
+int main()
+{
+  try {
+    vector<Segment> segments = split( 40000, 1400 );
+    expect_copies( "In-order segments", copies_per_byte( segments, false ), 0 );
+    expect_copies( "In-order segments with TCP options", copies_per_byte( segments, true ), 0 );
+
+    const vector<Segment> reversed { segments.rbegin(), segments.rend() };
+    expect_copies( "Segments in reverse order", copies_per_byte( reversed, true ), 0 );
+
+    // every other segment arrives, then the whole stream again in smaller, overlapping pieces
+    vector<Segment> overlapping;
+    for ( size_t i = 1; i < segments.size(); i += 2 ) {
+      overlapping.push_back( segments[i] );
+    }
+    for ( const auto& segment : split( 40000, 1000 ) ) {
+      overlapping.push_back( segment );
+    }
+    expect_copies( "Overlapping retransmissions", copies_per_byte( overlapping, false ), 0 );
+
+    // A datagram larger than a typical MTU spans two receive buffers, which are joined once.
+    expect_copies( "Segments larger than a typical MTU", copies_per_byte( split( 40000, 4000 ), false ), 1 );
+
+    expect_copies( "Wrapping a segment to send", copies_per_byte_sent( 40000 ), 0 );
+
+    // A segment cut from many small writes joins them once, not once per write.
+    expect_copies( "Segments from small writes", copies_per_byte_segmented( 40000, 100, 1400 ), 1 );
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
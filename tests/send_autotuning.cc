@@ -0,0 +1,147 @@
+#include "random.hh"
+#include "send_buffer_budget.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+// Send 4000 bytes that are acknowledged after 10 ms: a delivery rate of 400000 bytes/s and an RTT of 10 ms,
+// so the bandwidth-delay product is 4000 bytes.
+void one_round_trip( TCPSenderTestHarness& test, Wrap32 isn )
+{
+  test.execute( Push {} );
+  test.execute( ExpectMessage {}.with_syn( true ) );
+  test.execute( Tick { 10 } );
+  test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 20000 ) );
+  test.execute( Push { string( 4000, 'x' ) } );
+  for ( unsigned i = 0; i < 4; i++ ) {
+    test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+  }
+  test.execute( Tick { 10 } );
+  test.execute( AckReceived { Wrap32 { isn + 4001 } }.with_win( 20000 ) );
+}
+
+void expect_budget_returned()
+{
+  if ( SendBufferBudget::in_use() != 0 ) {
+    throw runtime_error( "send buffer budget not returned: " + to_string( SendBufferBudget::in_use() ) );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.send_capacity = 4000;
+
+      TCPSenderTestHarness test { "Capacity is fixed unless autotuning is enabled", cfg };
+      one_round_trip( test, isn );
+      test.execute( ExpectSendCapacity { 4000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.send_capacity = 4000;
+
+      TCPSenderTestHarness test { "Buffer grows to twice the BDP, and stays while data is in flight", cfg };
+      test.execute( EnableSendAutotuning { 100000 } );
+      one_round_trip( test, isn );
+      test.execute( ExpectSendCapacity { 8000 } );
+      test.execute( Push { string( 8000, 'y' ) } );
+      for ( unsigned i = 0; i < 8; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      }
+      test.execute( Tick { 2000 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 4001 ) );
+      test.execute( ExpectSendCapacity { 8000 } );
+    }
+    expect_budget_returned();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.send_capacity = 4000;
+
+      TCPSenderTestHarness test { "Idle buffer shrinks back to its configured capacity", cfg };
+      test.execute( EnableSendAutotuning { 100000 } );
+      one_round_trip( test, isn );
+      test.execute( ExpectSendCapacity { 8000 } );
+      test.execute( Tick { 999 } );
+      test.execute( ExpectSendCapacity { 8000 } );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectSendCapacity { 4000 } );
+      expect_budget_returned();
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.send_capacity = 4000;
+
+      TCPSenderTestHarness test { "Growth is bounded by the maximum capacity", cfg };
+      test.execute( EnableSendAutotuning { 6000 } );
+      one_round_trip( test, isn );
+      test.execute( ExpectSendCapacity { 6000 } );
+    }
+    expect_budget_returned();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.send_capacity = 4000;
+
+      SendBufferBudget::set_limit( 1500 );
+      TCPSenderTestHarness test { "Growth is bounded by the global budget", cfg };
+      test.execute( EnableSendAutotuning { 100000 } );
+      one_round_trip( test, isn );
+      test.execute( ExpectSendCapacity { 5500 } );
+      SendBufferBudget::set_limit( SendBufferBudget::DEFAULT_LIMIT );
+    }
+    expect_budget_returned();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      // The BDP uses the RTT measured without timestamps. A cumulative ACK gives one sample, from the newest
+      // segment it acknowledges, not one from each segment (which would weigh the oldest, longest waits).
+      TCPSenderTestHarness test { "One RTT sample per cumulative ACK", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Tick { 10 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 20000 ) );
+      test.execute( ExpectSRTT { 10 } );
+      for ( unsigned i = 0; i < 4; i++ ) {
+        test.execute( Push { string( 1000, 'x' ) } );
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+        test.execute( Tick { 10 } );
+      }
+      test.execute( AckReceived { Wrap32 { isn + 4001 } }.with_win( 20000 ) );
+      test.execute( ExpectSRTT { 10 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
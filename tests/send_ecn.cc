@@ -0,0 +1,91 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+namespace {
+constexpr uint8_t NOT_ECT = TCPSenderMessage::ECN_NOT_ECT;
+constexpr uint8_t ECT0 = TCPSenderMessage::ECN_ECT0;
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Without ECN, nothing is marked and ECE is ignored", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_ecn( NOT_ECT ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ) );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_ecn( NOT_ECT ).with_cwr( false ) );
+      test.execute( AckReceived { Wrap32 { isn + 4 } }.with_win( 1000 ).with_ece() );
+      test.execute( ExpectCongestionWindow { nullopt } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "ECE halves the window once per window of data, then CWR is sent", cfg };
+      test.execute( EnableECN {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_ecn( NOT_ECT ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 10000 ) );
+      test.execute( Push { string( 4000, 'x' ) } );
+      for ( unsigned i = 0; i < 4; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_ecn( ECT0 ).with_cwr( false ) );
+      }
+      test.execute( ExpectCongestionWindow { nullopt } );
+      test.execute( AckReceived { Wrap32 { isn + 1001 } }.with_win( 10000 ).with_ece() );
+      test.execute( ExpectCongestionWindow { 2000 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { Wrap32 { isn + 2001 } }.with_win( 10000 ).with_ece() );
+      test.execute( ExpectCongestionWindow { 2500 } );
+      test.execute( Push { string( 1000, 'y' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 500 ).with_seqno( isn + 4001 ).with_cwr( true ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { Wrap32 { isn + 4001 } }.with_win( 10000 ) );
+      test.execute( ExpectCongestionWindow { 3300 } );
+      test.execute( ExpectMessage {}.with_payload_size( 500 ).with_seqno( isn + 4501 ).with_cwr( false ) );
+      test.execute( AckReceived { Wrap32 { isn + 4501 } }.with_win( 10000 ).with_ece() );
+      test.execute( ExpectCongestionWindow { 2000 } );
+      test.execute( Push { "z" } );
+      test.execute( ExpectMessage {}.with_data( "z" ).with_cwr( true ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Retransmissions are not marked ECN-capable", cfg };
+      test.execute( EnableECN {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ) );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_ecn( ECT0 ) );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_ecn( NOT_ECT ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Retransmissions are counted", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ) );
+      test.execute( Push { string( 1000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectRetransmittedSegments { 0 } );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( Tick { 2UL * cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectRetransmittedSegments { 2 } );
+      test.execute( ExpectRetransmittedBytes { 2000 } );
+      test.execute( AckReceived { Wrap32 { isn + 1001 } }.with_win( 1000 ) );
+      test.execute( ExpectRetransmittedSegments { 2 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Duplicate ACKs and zero-window events", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 3000 ) );
+      test.execute( Push { string( 3000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( AckReceived { Wrap32 { isn + 1001 } }.with_win( 3000 ) );
+      test.execute( ExpectDuplicateAcks { 0 } );
+      test.execute( AckReceived { Wrap32 { isn + 1001 } }.with_win( 3000 ) );
+      test.execute( AckReceived { Wrap32 { isn + 1001 } }.with_win( 3000 ) );
+      test.execute( ExpectDuplicateAcks { 2 } );
+      test.execute( AckReceived { Wrap32 { isn + 1001 } }.with_win( 2000 ) ); // a window update
+      test.execute( ExpectDuplicateAcks { 2 } );
+      test.execute( ExpectZeroWindowEvents { 0 } );
+      test.execute( AckReceived { Wrap32 { isn + 3001 } }.with_win( 0 ) );
+      test.execute( AckReceived { Wrap32 { isn + 3001 } }.with_win( 0 ) );
+      test.execute( ExpectZeroWindowEvents { 1 } );
+      test.execute( AckReceived { Wrap32 { isn + 3001 } }.with_win( 1000 ) );
+      test.execute( AckReceived { Wrap32 { isn + 3001 } }.with_win( 0 ) );
+      test.execute( ExpectZeroWindowEvents { 2 } );
+      test.execute( ExpectDuplicateAcks { 2 } ); // nothing in flight
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.send_capacity = 500;
+
+      TCPSenderTestHarness test { "Time limited by the receive window and by the send buffer", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( Tick { 5 } );
+      test.execute( ExpectRwndLimited { 0 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 300 ) );
+      test.execute( Push { string( 500, 'a' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 300 ) );
+      test.execute( Tick { 7 } );
+      test.execute( ExpectRwndLimited { 7 } );
+      test.execute( ExpectSndbufLimited { 0 } );
+
+      // With Nagle's algorithm, a partial segment waits for the ACK and fills the buffer behind it.
+      test.execute( SetNagle { true } );
+      test.execute( AckReceived { Wrap32 { isn + 301 } }.with_win( 5000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 200 ) );
+      test.execute( Push { string( 500, 'b' ) } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 11 } );
+      test.execute( ExpectRwndLimited { 7 } );
+      test.execute( ExpectSndbufLimited { 11 } );
+      test.execute( AckReceived { Wrap32 { isn + 501 } }.with_win( 5000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 500 ) );
+      test.execute( Tick { 13 } );
+      test.execute( ExpectRwndLimited { 7 } );
+      test.execute( ExpectSndbufLimited { 11 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "No timestamps unless enabled", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( Tick { 50 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_tsecr( 0 ) );
+      test.execute( ExpectRTO { TCPConfig::TIMEOUT_DFLT } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "RTO follows the echoed timestamps", cfg };
+      test.execute( EnableTimestamps {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ).with_tsval( 1 ) );
+      test.execute( Tick { 300 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_tsecr( 1 ) );
+      test.execute( ExpectRTO { 900 } ); // SRTT 300 + 4 * RTTVAR 150
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_tsval( 301 ) );
+      test.execute( Tick { 100 } );
+      test.execute( AckReceived { Wrap32 { isn + 4 } }.with_tsecr( 301 ) );
+      test.execute( ExpectRTO { 923 } ); // SRTT 275 + 4 * RTTVAR 162
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Retransmissions carry fresh timestamps", cfg };
+      test.execute( EnableTimestamps {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_tsval( 1 ) );
+      test.execute( Tick { 10 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_tsecr( 1 ) );
+      test.execute( ExpectRTO { 200 } ); // never below the minimum
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_tsval( 11 ) );
+      test.execute( Tick { 200 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ).with_tsval( 211 ) );
+      test.execute( ExpectRTO { 400 } );
+      test.execute( Tick { 20 } );
+      // The echo shows the ACK was for the retransmission, so the sample is 20 ms, not 220 ms.
+      test.execute( AckReceived { Wrap32 { isn + 4 } }.with_tsecr( 211 ) );
+      test.execute( ExpectRTO { 200 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Echoes that name no send are not RTT samples", cfg };
+      test.execute( EnableTimestamps {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_tsval( 1 ) );
+      test.execute( Tick { 300 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_tsecr( 1 ) );
+      test.execute( ExpectRTO { 900 } );
+      test.execute( Push { "a" } );
+      test.execute( ExpectMessage {}.with_data( "a" ).with_tsval( 301 ) );
+      test.execute( Push { "b" } );
+      test.execute( ExpectMessage {}.with_data( "b" ).with_tsval( 301 ) );
+      test.execute( Push { "c" } );
+      test.execute( ExpectMessage {}.with_data( "c" ).with_tsval( 301 ) );
+      test.execute( Tick { 100 } );
+      // A TSecr of 0 means the peer echoed nothing.
+      test.execute( AckReceived { Wrap32 { isn + 2 } }.with_tsecr( 0 ) );
+      test.execute( ExpectRTO { 900 } );
+      // A TSecr ahead of our clock can't name anything we sent.
+      test.execute( AckReceived { Wrap32 { isn + 3 } }.with_tsecr( 5000 ) );
+      test.execute( ExpectRTO { 900 } );
+      // An ACK that doesn't move the left edge takes no sample, even with a plausible echo.
+      test.execute( AckReceived { Wrap32 { isn + 3 } }.with_tsecr( 301 ) );
+      test.execute( ExpectRTO { 900 } );
+      test.execute( AckReceived { Wrap32 { isn + 4 } }.with_tsecr( 301 ) );
+      test.execute( ExpectRTO { 923 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
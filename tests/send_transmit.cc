@@ -165,6 +165,50 @@ int main()
       test.execute( ExpectSeqno { Wrap32 { isn + 1 + 3 } } );
     }
 
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Window filled in one batch", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 2500 ) );
+      test.execute( PushBatch { string( 4000, 'x' ), 3 } );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 500 ).with_seqno( isn + 2001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 2500 } );
+      test.execute( AckReceived { Wrap32 { isn + 2501 } }.with_win( 2500 ).without_push() );
+      test.execute( PushBatch { "", 2 } );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 2501 ) );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 500 ).with_seqno( isn + 3501 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Segment spanning several writes, then retransmitted", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( Push { "abc" } );
+      test.execute( Push { "def" } );
+      test.execute( Push { "ghijkl" } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 8 ) );
+      test.execute( ExpectMessage {}.with_no_flags().with_data( "abcdefgh" ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_no_flags().with_data( "abcdefgh" ).with_seqno( isn + 1 ) );
+      test.execute( AckReceived { Wrap32 { isn + 9 } }.with_win( 8 ) );
+      test.execute( ExpectMessage {}.with_no_flags().with_data( "ijkl" ).with_seqno( isn + 9 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return 1;
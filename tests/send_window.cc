@@ -137,6 +137,34 @@ int main()
       test.execute( ExpectMessage {}.with_fin( true ).with_data( "4567" ) );
       test.execute( ExpectNoSegment {} );
     }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.send_capacity = 300000;
+
+      TCPSenderTestHarness test { "Scaled window can exceed 64 KiB", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 3 ) );
+      test.execute( SetWindowShift { 1 } );
+      test.execute( Push { "1234567" } );
+      test.execute( ExpectMessage {}.with_no_flags().with_data( "123" ) );
+      test.execute( ExpectNoSegment {} ); // the SYN's window was not scaled
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 3 ) );
+      test.execute( ExpectMessage {}.with_no_flags().with_data( "456" ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( SetWindowShift { 14 } );
+      test.execute( AckReceived { Wrap32 { isn + 7 } }.with_win( 16 ) );
+      test.execute( ExpectMessage {}.with_no_flags().with_data( "7" ) );
+      test.execute( Push { string( 200000, 'x' ) } );
+      for ( size_t i = 0; i < 200; ++i ) {
+        test.execute( ExpectMessage {}.with_no_flags().with_payload_size( TCPConfig::MAX_PAYLOAD_SIZE ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 200001 } );
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return 1;
@@ -122,6 +122,191 @@ struct SetError : public Action<TCPSender>
   void execute( TCPSender& sender ) const override { sender.writer().set_error(); }
 };
 
+struct SetWindowShift : public Action<TCPSender>
+{
+  uint8_t shift_;
+  explicit SetWindowShift( uint8_t shift ) : shift_( shift ) {}
+  std::string description() const override { return "set window shift to " + std::to_string( shift_ ); }
+  void execute( TCPSender& sender ) const override { sender.set_window_shift( shift_ ); }
+};
+
+struct SetNagle : public Action<TCPSender>
+{
+  bool enabled_;
+  explicit SetNagle( bool enabled ) : enabled_( enabled ) {}
+  std::string description() const override { return enabled_ ? "enable Nagle" : "disable Nagle"; }
+  void execute( TCPSender& sender ) const override { sender.set_nagle( enabled_ ); }
+};
+
+struct SetCork : public Action<TCPSender>
+{
+  bool corked_;
+  explicit SetCork( bool corked ) : corked_( corked ) {}
+  std::string description() const override { return corked_ ? "cork" : "uncork"; }
+  void execute( TCPSender& sender ) const override { sender.set_cork( corked_ ); }
+};
+
+struct SetPacing : public Action<TCPSender>
+{
+  uint64_t rate_;
+  explicit SetPacing( uint64_t rate = 0 ) : rate_( rate ) {}
+  std::string description() const override
+  {
+    return rate_ ? "pace at " + std::to_string( rate_ ) + " bytes/s" : "pace at twice the delivery rate";
+  }
+  void execute( TCPSender& sender ) const override { sender.set_pacing( true, rate_ ); }
+};
+
+struct ExpectPacingRate : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "pacing_rate"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.pacing_rate(); }
+};
+
+struct ExpectPacedSegments : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "paced_segments"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.paced_segments(); }
+};
+
+struct ExpectBurstSegments : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "burst_segments"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.burst_segments(); }
+};
+
+struct SetMSS : public Action<TCPSender>
+{
+  uint64_t mss_;
+  explicit SetMSS( uint64_t mss ) : mss_( mss ) {}
+  std::string description() const override { return "set MSS to " + std::to_string( mss_ ); }
+  void execute( TCPSender& sender ) const override { sender.set_mss( mss_ ); }
+};
+
+struct EnableMTUProbing : public Action<TCPSender>
+{
+  uint64_t max_mss_;
+  explicit EnableMTUProbing( uint64_t max_mss ) : max_mss_( max_mss ) {}
+  std::string description() const override { return "probe MSS up to " + std::to_string( max_mss_ ); }
+  void execute( TCPSender& sender ) const override { sender.enable_mtu_probing( max_mss_ ); }
+};
+
+struct ExpectMSS : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "mss"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.mss(); }
+};
+
+struct EnableTimestamps : public Action<TCPSender>
+{
+  std::string description() const override { return "enable timestamps"; }
+  void execute( TCPSender& sender ) const override { sender.set_timestamps( true ); }
+};
+
+struct ExpectRTO : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "current_RTO_ms"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.current_RTO_ms(); }
+};
+
+struct ExpectSRTT : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "srtt_ms().value_or( 0 )"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.srtt_ms().value_or( 0 ); }
+};
+
+struct EnableRackTlp : public Action<TCPSender>
+{
+  std::string description() const override { return "enable RACK-TLP"; }
+  void execute( TCPSender& sender ) const override { sender.set_rack_tlp( true ); }
+};
+
+struct ExpectTailLossProbes : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "tail_loss_probes"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.tail_loss_probes(); }
+};
+
+struct EnableECN : public Action<TCPSender>
+{
+  std::string description() const override { return "enable ECN"; }
+  void execute( TCPSender& sender ) const override { sender.set_ecn( true ); }
+};
+
+struct ExpectCongestionWindow : public ExpectNumber<TCPSender, std::optional<uint64_t>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_window"; }
+  std::optional<uint64_t> value( const TCPSender& sender ) const override { return sender.congestion_window(); }
+};
+
+struct EnableSendAutotuning : public Action<TCPSender>
+{
+  uint64_t max_capacity_;
+  explicit EnableSendAutotuning( uint64_t max_capacity ) : max_capacity_( max_capacity ) {}
+  std::string description() const override
+  {
+    return "autotune the send buffer up to " + std::to_string( max_capacity_ ) + " bytes";
+  }
+  void execute( TCPSender& sender ) const override { sender.set_send_autotuning( true, max_capacity_ ); }
+};
+
+struct ExpectSendCapacity : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "writer().capacity()"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.writer().capacity(); }
+};
+
+struct ExpectRetransmittedSegments : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "retransmitted_segments"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.retransmitted_segments(); }
+};
+
+struct ExpectRetransmittedBytes : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "retransmitted_bytes"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.retransmitted_bytes(); }
+};
+
+struct ExpectDuplicateAcks : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "duplicate_acks"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.duplicate_acks(); }
+};
+
+struct ExpectZeroWindowEvents : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "zero_window_events"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.zero_window_events(); }
+};
+
+struct ExpectRwndLimited : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rwnd_limited_ms"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.rwnd_limited_ms(); }
+};
+
+struct ExpectSndbufLimited : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "sndbuf_limited_ms"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.sndbuf_limited_ms(); }
+};
+
 struct HasError : public ExpectBool<TCPSender>
 {
   using ExpectBool::ExpectBool;
@@ -168,6 +353,34 @@ struct Push : public Action<SenderAndOutput>
   constexpr std::string obj() const override { return "TCPSender"; }
 };
 
+struct PushBatch : public Push
+{
+  size_t expected_segments_;
+
+  PushBatch( std::string data, size_t expected_segments )
+    : Push( move( data ) ), expected_segments_( expected_segments )
+  {}
+  std::string description() const override
+  {
+    return Push::description() + " in one batch of " + std::to_string( expected_segments_ ) + " segment(s)";
+  }
+  void execute( SenderAndOutput& ss ) const override
+  {
+    if ( not data_.empty() ) {
+      ss.sender.writer().push( data_ );
+    }
+    TCPSender::Batch batch;
+    ss.sender.push( batch );
+    if ( batch.size() != expected_segments_ ) {
+      throw ExpectationViolation( "TCPSender::push() batched " + std::to_string( batch.size() )
+                                  + " segment(s), expected " + std::to_string( expected_segments_ ) );
+    }
+    for ( const TCPSenderMessage& msg : batch ) {
+      ss.output.push( msg );
+    }
+  }
+};
+
 struct Tick : public Action<SenderAndOutput>
 {
   uint64_t ms_;
@@ -222,7 +435,17 @@ struct Receive : public Action<SenderAndOutput>
   std::string description() const override
   {
     std::ostringstream desc;
-    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size << ")";
+    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size;
+    for ( const auto& block : msg_.sack ) {
+      desc << ", sack=[" << to_string( block.begin ) << ", " << to_string( block.end ) << ")";
+    }
+    if ( msg_.tsecr.has_value() ) {
+      desc << ", tsecr=" << msg_.tsecr.value();
+    }
+    if ( msg_.ECE ) {
+      desc << ", +ECE";
+    }
+    desc << ")";
     if ( push_ ) {
       desc << ", then push";
     }
@@ -235,6 +458,24 @@ struct Receive : public Action<SenderAndOutput>
     return *this;
   }
 
+  Receive& with_sack( Wrap32 begin, Wrap32 end )
+  {
+    msg_.sack.push_back( { begin, end } );
+    return *this;
+  }
+
+  Receive& with_tsecr( uint32_t tsecr )
+  {
+    msg_.tsecr = tsecr;
+    return *this;
+  }
+
+  Receive& with_ece()
+  {
+    msg_.ECE = true;
+    return *this;
+  }
+
   void execute( SenderAndOutput& ss ) const override
   {
     ss.sender.receive( msg_ );
@@ -283,8 +524,11 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
   std::optional<Wrap32> seqno {};
   std::optional<std::string> data {};
   std::optional<size_t> payload_size {};
+  std::optional<uint32_t> tsval {};
+  std::optional<bool> cwr {};
+  std::optional<uint8_t> ecn {};
 
-  bool empty() const { return not( syn or fin or rst or seqno or data or payload_size ); }
+  bool empty() const { return not( syn or fin or rst or seqno or data or payload_size or tsval or cwr or ecn ); }
 
   ExpectMessage& with_syn( bool syn_ )
   {
@@ -318,6 +562,24 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
 
   ExpectMessage& with_seqno( uint32_t seqno_ ) { return with_seqno( Wrap32 { seqno_ } ); }
 
+  ExpectMessage& with_tsval( uint32_t tsval_ )
+  {
+    tsval = tsval_;
+    return *this;
+  }
+
+  ExpectMessage& with_cwr( bool cwr_ )
+  {
+    cwr = cwr_;
+    return *this;
+  }
+
+  ExpectMessage& with_ecn( uint8_t ecn_ )
+  {
+    ecn = ecn_;
+    return *this;
+  }
+
   ExpectMessage& with_payload_size( size_t payload_size_ )
   {
     payload_size = payload_size_;
@@ -361,6 +623,15 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( rst.has_value() ) {
       o << ( rst.value() ? " +RST" : " -RST" );
     }
+    if ( tsval.has_value() ) {
+      o << " TSval=" << tsval.value();
+    }
+    if ( cwr.has_value() ) {
+      o << ( cwr.value() ? " +CWR" : " -CWR" );
+    }
+    if ( ecn.has_value() ) {
+      o << " ECN=" << static_cast<unsigned>( ecn.value() );
+    }
     return o.str();
   }
 
@@ -377,10 +648,10 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
 
     const TCPSenderMessage seg = ss.expect_message();
 
-    if ( seg.payload.size() > TCPConfig::MAX_PAYLOAD_SIZE ) {
+    if ( seg.payload.size() > ss.sender.max_payload_size() ) {
       throw ExpectationViolation( "sent a message with a " + std::to_string( seg.payload.size() )
                                   + "-byte payload, which is longer than the maximum ("
-                                  + std::to_string( TCPConfig::MAX_PAYLOAD_SIZE ) + ")" );
+                                  + std::to_string( ss.sender.max_payload_size() ) + ")" );
     }
     if ( syn.has_value() and seg.SYN != syn.value() ) {
       throw MessageExpectationViolation( seg, "SYN flag", syn.value(), seg.SYN );
@@ -400,6 +671,15 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( data.has_value() and data.value() != static_cast<std::string>( seg.payload ) ) {
       throw MessageExpectationViolation( seg, "payload", data.value(), static_cast<std::string>( seg.payload ) );
     }
+    if ( tsval.has_value() and seg.tsval != tsval ) {
+      throw MessageExpectationViolation( seg, "TSval", tsval, seg.tsval );
+    }
+    if ( cwr.has_value() and seg.CWR != cwr.value() ) {
+      throw MessageExpectationViolation( seg, "CWR flag", cwr.value(), seg.CWR );
+    }
+    if ( ecn.has_value() and seg.ecn != ecn.value() ) {
+      throw MessageExpectationViolation( seg, "ECN codepoint", ecn.value(), seg.ecn );
+    }
   }
 
   constexpr std::string obj() const override { return "TCPSender"; }
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// The properties of one direction of a simulated path
+struct LinkConfig
+{
+  uint64_t bandwidth = 100'000'000; // bottleneck rate, in bits per second
+  uint64_t delay_ms = 10;           // one-way propagation delay
+  size_t queue_bytes = 128 * 1024;  // drop-tail queue in front of the bottleneck
+  double loss = 0;                  // probability that a segment is lost on the way
+  double reorder = 0;               // probability that a segment is held back, so later ones overtake it
+  uint64_t reorder_delay_ms = 3;    // how long a reordered segment is held back
+  uint64_t seed = 1;                // seed for the loss and reordering decisions
+};
+
+/*
+ * One direction of a path, in virtual time: a drop-tail queue drained by a bottleneck of fixed bandwidth,
+ * then a fixed propagation delay. Loss and reordering are drawn from a generator with a fixed seed, so
+ * every run with the same config sees the same segments lost and reordered.
+ */
+class SimulatedLink
+{
+public:
+  static constexpr uint64_t HEADER_BYTES = 40; // IPv4 and TCP headers, counted against the bandwidth
+
+  explicit SimulatedLink( const LinkConfig& config ) : config_( config ), rng_( config.seed ) {}
+
+  // A segment enters the link at time `now_us`
+  void send( const TCPMessage& msg, uint64_t now_us )
+  {
+    sent_++;
+    const uint64_t bytes = msg.sender->payload.size() + HEADER_BYTES;
+
+    // Segments that have left the queue by now no longer take up room in it.
+    while ( not queue_.empty() and queue_.front().first <= now_us ) {
+      queued_bytes_ -= queue_.front().second;
+      queue_.pop_front();
+    }
+    if ( queued_bytes_ + bytes > config_.queue_bytes ) {
+      queue_drops_++;
+      return;
+    }
+
+    const uint64_t departure_us = std::max( now_us, bottleneck_free_us_ ) + bytes * 8'000'000 / config_.bandwidth;
+    bottleneck_free_us_ = departure_us;
+    queue_.emplace_back( departure_us, bytes );
+    queued_bytes_ += bytes;
+
+    if ( chance( config_.loss ) ) {
+      random_losses_++;
+      return;
+    }
+    uint64_t arrival_us = departure_us + config_.delay_ms * 1000;
+    if ( chance( config_.reorder ) ) {
+      reordered_++;
+      arrival_us += config_.reorder_delay_ms * 1000;
+    }
+    in_flight_.emplace(
+      arrival_us, TCPMessage { TCPSenderMessage { msg.sender.get() }, TCPReceiverMessage { msg.receiver.get() } } );
+  }
+
+  // Hand `receive` every segment that has arrived by `now_us`, in order of arrival
+  void deliver( uint64_t now_us, const std::function<void( TCPMessage )>& receive )
+  {
+    while ( not in_flight_.empty() and in_flight_.begin()->first <= now_us ) {
+      TCPMessage msg = std::move( in_flight_.begin()->second );
+      in_flight_.erase( in_flight_.begin() );
+      delivered_++;
+      receive( std::move( msg ) );
+    }
+  }
+
+  uint64_t sent() const { return sent_; }
+  uint64_t delivered() const { return delivered_; }
+  uint64_t queue_drops() const { return queue_drops_; }
+  uint64_t random_losses() const { return random_losses_; }
+  uint64_t reordered() const { return reordered_; }
+
+private:
+  LinkConfig config_;
+  std::default_random_engine rng_;
+
+  std::deque<std::pair<uint64_t, uint64_t>> queue_ {}; // departure time and size of each queued segment
+  uint64_t queued_bytes_ {};
+  uint64_t bottleneck_free_us_ {};
+  std::multimap<uint64_t, TCPMessage> in_flight_ {}; // by arrival time (segments arriving together keep order)
+
+  uint64_t sent_ {};
+  uint64_t delivered_ {};
+  uint64_t queue_drops_ {};
+  uint64_t random_losses_ {};
+  uint64_t reordered_ {};
+
+  bool chance( double probability )
+  {
+    return probability > 0 and std::uniform_real_distribution<double> {}( rng_ ) < probability;
+  }
+};
+
+// Two TCPPeers joined by a SimulatedLink each way, driven in steps of one millisecond of virtual time.
+class SimulatedNetwork
+{
+public:
+  SimulatedNetwork( const TCPConfig& client_config,
+                    const TCPConfig& server_config,
+                    const LinkConfig& to_server,
+                    const LinkConfig& to_client )
+    : client_( client_config ), server_( server_config ), to_server_( to_server ), to_client_( to_client )
+  {}
+
+  TCPPeer& client() { return client_; }
+  TCPPeer& server() { return server_; }
+  const SimulatedLink& client_to_server() const { return to_server_; }
+  const SimulatedLink& server_to_client() const { return to_client_; }
+  uint64_t now_ms() const { return now_ms_; }
+
+  // The client sends its SYN
+  void connect() { client_.push( transmit( to_server_ ) ); }
+
+  // Send what the application has written to each side's outbound stream
+  void client_push() { client_.push( transmit( to_server_ ) ); }
+  void server_push() { server_.push( transmit( to_client_ ) ); }
+
+  // Advance virtual time by one millisecond: deliver what has arrived, then let each peer's timers run
+  void step()
+  {
+    now_ms_++;
+    to_server_.deliver( now_ms_ * 1000,
+                        [this]( TCPMessage msg ) { server_.receive( std::move( msg ), transmit( to_client_ ) ); } );
+    to_client_.deliver( now_ms_ * 1000,
+                        [this]( TCPMessage msg ) { client_.receive( std::move( msg ), transmit( to_server_ ) ); } );
+    client_.tick( 1, transmit( to_server_ ) );
+    server_.tick( 1, transmit( to_client_ ) );
+  }
+
+  // Step until `done` (called before each step, e.g. to act as the application), or fail after `limit_ms`
+  void run_until( const std::function<bool()>& done, uint64_t limit_ms )
+  {
+    const uint64_t deadline = now_ms_ + limit_ms;
+    while ( not done() ) {
+      if ( now_ms_ >= deadline ) {
+        throw std::runtime_error( "simulation did not finish within " + std::to_string( limit_ms ) + " ms" );
+      }
+      step();
+    }
+  }
+
+private:
+  TCPPeer client_;
+  TCPPeer server_;
+  SimulatedLink to_server_;
+  SimulatedLink to_client_;
+  uint64_t now_ms_ {};
+
+  TCPPeer::TransmitFunction transmit( SimulatedLink& link )
+  {
+    return [this, &link]( std::span<const TCPMessage> batch ) {
+      for ( const auto& msg : batch ) {
+        link.send( msg, now_ms_ * 1000 );
+      }
+    };
+  }
+};
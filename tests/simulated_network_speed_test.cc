@@ -0,0 +1,143 @@
+#include "simulated_network.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+constexpr size_t TRANSFER_SIZE = 4 << 20;
+constexpr uint64_t TIME_LIMIT_MS = 60 * 1000;
+
+struct Result
+{
+  uint64_t virtual_ms;
+  uint64_t retransmissions;
+  double cpu_seconds;
+};
+
+// Send TRANSFER_SIZE bytes from the client to the server across the simulated path, with each side's
+// application writing and reading as fast as its TCPPeer allows.
+Result transfer( const TCPConfig& cfg, const LinkConfig& link )
+{
+  string data( TRANSFER_SIZE, 0 );
+  for ( size_t i = 0; i < data.size(); i++ ) {
+    data[i] = static_cast<char>( 'a' + i % 26 );
+  }
+
+  SimulatedNetwork net { cfg, cfg, link, link };
+  TCPPeer& client = net.client();
+  TCPPeer& server = net.server();
+  size_t written = 0;
+  size_t read = 0;
+
+  const clock_t start = clock();
+  net.connect();
+  net.run_until(
+    [&] {
+      Writer& writer = client.outbound_writer();
+      if ( written < data.size() and writer.available_capacity() > 0 ) {
+        const size_t len = min( writer.available_capacity(), data.size() - written );
+        writer.push( data.substr( written, len ) );
+        written += len;
+        if ( written == data.size() ) {
+          writer.close();
+        }
+        net.client_push();
+      }
+
+      Reader& reader = server.inbound_reader();
+      while ( reader.bytes_buffered() > 0 ) {
+        const string_view chunk = reader.peek();
+        if ( read + chunk.size() > data.size() or memcmp( chunk.data(), data.data() + read, chunk.size() ) != 0 ) {
+          throw runtime_error( "the server received the wrong data" );
+        }
+        read += chunk.size();
+        reader.pop( chunk.size() );
+      }
+      return reader.is_finished();
+    },
+    TIME_LIMIT_MS );
+  const clock_t stop = clock();
+
+  if ( read != data.size() ) {
+    throw runtime_error( "not all of the data was received" );
+  }
+  return { net.now_ms(),
+           client.sender().retransmitted_segments(),
+           static_cast<double>( stop - start ) / CLOCKS_PER_SEC };
+}
+
+double report( string_view scenario, const LinkConfig& link, const Result& result )
+{
+  const double goodput = TRANSFER_SIZE * 8.0 / ( static_cast<double>( result.virtual_ms ) / 1000 );
+  const double ns_per_byte = result.cpu_seconds * 1e9 / TRANSFER_SIZE;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Simulated " << scenario << ": goodput " << fixed << setprecision( 1 ) << goodput / 1e6 << " of "
+       << static_cast<double>( link.bandwidth ) / 1e6 << " Mbit/s, " << result.retransmissions
+       << " retransmissions, " << setprecision( 2 ) << ns_per_byte << " ns of CPU per byte.\n";
+  debug_output << "        Simulated " << setw( 22 ) << left << scenario << right << ": " << fixed
+               << setprecision( 1 ) << setw( 6 ) << goodput / 1e6 << " Mbit/s goodput, " << setw( 5 )
+               << result.retransmissions << " retransmissions, " << setprecision( 2 ) << setw( 5 ) << ns_per_byte
+               << " ns CPU/byte\n";
+  return goodput;
+}
+
+void program_body()
+{
+  // 100 Mbit/s with a 20 ms round trip: a window of the bandwidth-delay product (250 kB) fills the path.
+  TCPConfig cfg;
+  cfg.window_scale = true;
+  cfg.sack = true;
+  cfg.rack_tlp = true;
+  cfg.recv_capacity = 256 * 1024;
+  cfg.send_capacity = 1 << 20;
+
+  LinkConfig clean;
+  clean.queue_bytes = cfg.send_capacity; // room for a whole window sent at once
+  const double goodput = report( "clean path", clean, transfer( cfg, clean ) );
+  if ( goodput < 0.5 * static_cast<double>( clean.bandwidth ) ) {
+    throw runtime_error( "TCPPeer did not reach half of the bandwidth of a clean path." );
+  }
+
+  LinkConfig lossy = clean;
+  lossy.loss = 0.01;
+  const Result first = transfer( cfg, lossy );
+  report( "1% loss", lossy, first );
+  const Result second = transfer( cfg, lossy );
+  if ( second.virtual_ms != first.virtual_ms or second.retransmissions != first.retransmissions ) {
+    throw runtime_error( "the same simulation ran differently twice" );
+  }
+
+  LinkConfig reordering = clean;
+  reordering.reorder = 0.02;
+  report( "2% reordering", reordering, transfer( cfg, reordering ) );
+
+  LinkConfig shallow_queue = clean;
+  shallow_queue.queue_bytes = 16 * 1024;
+  report( "16 kB bottleneck queue", shallow_queue, transfer( cfg, shallow_queue ) );
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+#include "demux_test_harness.hh"
+#include "helpers.hh"
+#include "tcp_coalescer.hh"
+#include "tcp_demux.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr uint32_t ISN = 1000;
+constexpr uint32_t ACKNO = 5000;
+const FourTuple flow_a { 0x0a000002, 20000, 0x0a000001, 80 };
+const FourTuple flow_b { 0x0a000002, 20001, 0x0a000001, 80 };
+
+// A data segment carrying bytes [offset, offset + payload.size()) of the stream
+TCPMessage segment( uint32_t offset, Slice payload, bool fin = false )
+{
+  TCPSenderMessage sender;
+  sender.seqno = Wrap32 { ISN + 1 + offset };
+  sender.payload = move( payload );
+  sender.FIN = fin;
+  TCPReceiverMessage receiver;
+  receiver.ackno = Wrap32 { ACKNO };
+  receiver.window_size = 10000;
+  return { move( sender ), move( receiver ) };
+}
+
+vector<pair<FourTuple, TCPMessage>> flush( TCPSegmentCoalescer& coalescer )
+{
+  vector<pair<FourTuple, TCPMessage>> out;
+  coalescer.flush( [&]( const FourTuple& key, TCPMessage msg ) { out.emplace_back( key, move( msg ) ); } );
+  return out;
+}
+
+string payload_of( const TCPMessage& msg )
+{
+  return string { msg.sender->payload.view() };
+}
+
+void coalescer_unit()
+{
+  const string stream = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+  {
+    // Segments cut from one buffer are merged without a copy, and the FIN stays on the end.
+    TCPSegmentCoalescer coalescer;
+    const Slice buffer { stream };
+    for ( uint32_t i = 0; i < 6; i++ ) {
+      coalescer.add( flow_a, segment( i * 6, buffer.substr( i * 6, 6 ), i == 5 ) );
+    }
+    coalescer.add( flow_a, segment( 36, Slice { string { "after FIN" } } ) );
+    auto out = flush( coalescer );
+    expect( out.size() == 2, "in-order segments should merge into one, ending at the FIN" );
+    expect( payload_of( out[0].second ) == stream, "merged payload should be the whole stream" );
+    expect( out[0].second.sender->FIN, "merged segment should keep the FIN" );
+    expect( out[0].second.sender->payload.view().data() == buffer.view().data(),
+            "segments of one buffer should be merged without copying" );
+    expect( payload_of( out[1].second ) == "after FIN", "nothing should merge past a FIN" );
+    expect( coalescer.segments_added() == 7 and coalescer.segments_delivered() == 2, "counters" );
+  }
+
+  {
+    // Interleaved connections are coalesced separately, each keeping its own order.
+    TCPSegmentCoalescer coalescer;
+    for ( uint32_t i = 0; i < 4; i++ ) {
+      coalescer.add( flow_a, segment( i * 2, Slice { stream.substr( i * 2, 2 ) } ) );
+      coalescer.add( flow_b, segment( i * 3, Slice { stream.substr( 10 + i * 3, 3 ) } ) );
+    }
+    auto out = flush( coalescer );
+    expect( out.size() == 2, "each connection should get one segment" );
+    expect( out[0].first == flow_a and payload_of( out[0].second ) == stream.substr( 0, 8 ), "first connection" );
+    expect( out[1].first == flow_b and payload_of( out[1].second ) == stream.substr( 10, 12 ),
+            "second connection" );
+  }
+
+  {
+    // A gap, a new ackno, a pure ACK, an RST and the size limit each end a run.
+    TCPSegmentCoalescer coalescer { 8 };
+    coalescer.add( flow_a, segment( 0, Slice { string { "aaaa" } } ) );
+    coalescer.add( flow_a, segment( 8, Slice { string { "cccc" } } ) ); // gap
+    TCPMessage new_ack = segment( 12, Slice { string { "dddd" } } );
+    new_ack.receiver->ackno = Wrap32 { ACKNO + 10 };
+    coalescer.add( flow_a, move( new_ack ) );
+    coalescer.add( flow_a, segment( 16, Slice {} ) ); // pure ACK
+    coalescer.add( flow_a, segment( 16, Slice { string { "eeee" } } ) );
+    coalescer.add( flow_a, segment( 20, Slice { string { "ffff" } } ) );
+    coalescer.add( flow_a, segment( 24, Slice { string { "gggg" } } ) ); // would exceed 8 bytes
+    TCPMessage reset = segment( 28, Slice { string { "hhhh" } } );
+    reset.sender->RST = true;
+    coalescer.add( flow_a, move( reset ) );
+    auto out = flush( coalescer );
+
+    vector<string> payloads;
+    for ( const auto& [key, msg] : out ) {
+      payloads.push_back( payload_of( msg ) );
+    }
+    expect( payloads == vector<string> { "aaaa", "cccc", "dddd", "", "eeeeffff", "gggg", "hhhh" },
+            "runs should end at each boundary" );
+    expect( out.back().second.sender->RST, "RST should be kept" );
+  }
+}
+
+// Two demultiplexers joined by queues of serialized datagrams: a burst of in-order segments, handed to the
+// server in one batch, reaches its TCPPeer as one segment and is acknowledged once.
+void through_demux()
+{
+  // Unlike DemuxNetwork::deliver, hand each host everything queued for it as one batch
+  const auto datagrams = []( deque<string>& queue ) {
+    vector<InternetDatagram> out;
+    for ( auto& datagram : queue ) {
+      InternetDatagram ip_dgram;
+      expect( parse( ip_dgram, vector<string> { move( datagram ) } ), "datagram should parse" );
+      out.push_back( move( ip_dgram ) );
+    }
+    queue.clear();
+    return out;
+  };
+
+  DemuxNetwork net;
+  net.server.listen( 80 );
+  TCPPeer& client_peer = net.client.connect( Address { "10.0.0.2", 20000 }, net.server_address );
+  while ( not net.to_server.empty() or not net.to_client.empty() ) {
+    net.server.receive( datagrams( net.to_server ) );
+    net.client.receive( datagrams( net.to_client ) );
+  }
+
+  constexpr size_t segments = 20;
+  string data;
+  for ( size_t i = 0; i < segments * TCPConfig::MAX_PAYLOAD_SIZE; i++ ) {
+    data.push_back( static_cast<char>( 'a' + i % 26 ) );
+  }
+  client_peer.outbound_writer().push( data );
+  net.client.push( net.at_client( 20000 ) );
+  expect( net.to_server.size() == segments, "client should send the data in full-sized segments" );
+
+  const uint64_t before = net.server.coalescer().segments_delivered();
+  net.server.receive( datagrams( net.to_server ) );
+  expect( net.server.coalescer().segments_delivered() - before == 1,
+          "the burst should reach the server as one segment" );
+  expect( net.to_client.size() == 1, "the server should acknowledge the burst once" );
+
+  TCPPeer* server_peer = net.server.find( net.at_server( 20000 ) );
+  expect( server_peer != nullptr, "server should have the connection" );
+  string received;
+  read( server_peer->inbound_reader(), server_peer->inbound_reader().bytes_buffered(), received );
+  expect( received == data, "server should receive the data intact" );
+
+  net.client.receive( datagrams( net.to_client ) );
+  expect( client_peer.sender().sequence_numbers_in_flight() == 0, "the one ACK should cover the whole burst" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    coalescer_unit();
+    through_demux();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
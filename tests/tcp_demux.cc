@@ -0,0 +1,159 @@
+#include "demux_test_harness.hh"
+#include "helpers.hh"
+#include "tcp_demux.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// Connections hold a pointer to their demultiplexer
+static_assert( not is_move_constructible_v<TCPOverIPv4Demultiplexer> );
+static_assert( not is_move_assignable_v<TCPOverIPv4Demultiplexer> );
+
+FourTuple key( uint32_t i )
+{
+  return { 0x0a000002, static_cast<uint16_t>( i ), 0x0a000001, 80 };
+}
+
+void four_tuple_map( uint64_t seed )
+{
+  FourTupleMap<uint32_t> map { seed };
+
+  for ( uint32_t i = 0; i < 10000; i++ ) {
+    expect( map.insert( key( i ), i ).second, "new key should be inserted" );
+  }
+  expect( not map.insert( key( 5 ), 0 ).second, "existing key should not be inserted again" );
+  expect( map.size() == 10000, "map should hold 10000 keys" );
+
+  for ( uint32_t i = 1; i < 10000; i += 2 ) {
+    expect( map.erase( key( i ) ), "present key should be erased" );
+  }
+  expect( not map.erase( key( 1 ) ), "absent key should not be erased" );
+  expect( map.size() == 5000, "map should hold 5000 keys" );
+
+  for ( uint32_t i = 0; i < 10000; i++ ) {
+    const uint32_t* value = map.find( key( i ) );
+    if ( i % 2 ) {
+      expect( value == nullptr, "erased key should not be found" );
+    } else {
+      expect( value != nullptr and *value == i, "remaining key should be found with its value" );
+    }
+  }
+}
+
+// Keys that share a slot under one seed should be spread out under another
+void four_tuple_hash_seed()
+{
+  constexpr uint64_t slots = 1024;
+  uint32_t same_slot = 0;
+  for ( uint32_t i = 0; i < 10000; i++ ) {
+    same_slot += ( key( i ).hash( 1 ) % slots ) == ( key( i ).hash( 2 ) % slots );
+  }
+  expect( same_slot < 100,
+          "seeds should place keys in unrelated slots, but " + to_string( same_slot ) + " keys shared one" );
+}
+
+void many_connections()
+{
+  constexpr uint16_t connections = 1000;
+  constexpr uint16_t first_port = 20000;
+  DemuxNetwork network;
+  TCPOverIPv4Demultiplexer& server = network.server;
+  TCPOverIPv4Demultiplexer& client = network.client;
+
+  size_t accepted = 0;
+  server.listen( 80, [&]( const FourTuple& addresses, TCPPeer& /*peer*/ ) {
+    expect( addresses.dst_port == 80 and addresses.src_ip == network.client_ip,
+            "accepted connection has wrong addresses" );
+    accepted++;
+  } );
+
+  vector<TCPPeer*> client_peers;
+  for ( uint16_t i = 0; i < connections; i++ ) {
+    const Address local { "10.0.0.2", static_cast<uint16_t>( first_port + i ) };
+    client_peers.push_back( &client.connect( local, network.server_address ) );
+  }
+  // the four-tuple of connection i, as seen on segments arriving at the client and at the server
+  const auto at_client = [&]( uint16_t i ) { return network.at_client( first_port + i ); };
+  const auto at_server = [&]( uint16_t i ) { return network.at_server( first_port + i ); };
+  network.run();
+  expect( accepted == connections, "server should accept every connection" );
+  expect( server.connection_count() == connections, "server should have every connection" );
+  expect( client.connection_count() == connections, "client should have every connection" );
+
+  // idle connections have no timer running, so ticks pass them by
+  const uint64_t expirations = client.timer_expirations() + server.timer_expirations();
+  for ( int i = 0; i < 1000; i++ ) {
+    client.tick( 1 );
+    server.tick( 1 );
+  }
+  expect( client.timer_expirations() + server.timer_expirations() == expirations, "idle connections were ticked" );
+
+  // each connection carries its own data, both ways
+  for ( uint16_t i = 0; i < connections; i++ ) {
+    client_peers[i]->outbound_writer().push( "request " + to_string( i ) );
+    client_peers[i]->outbound_writer().close();
+    expect( client.find( at_client( i ) ) == client_peers[i], "client should find the connection it opened" );
+    client.push( at_client( i ) );
+  }
+  network.run();
+
+  for ( uint16_t i = 0; i < connections; i++ ) {
+    TCPPeer* peer = server.find( at_server( i ) );
+    expect( peer != nullptr, "server should find the connection by its four-tuple" );
+    string data;
+    read( peer->inbound_reader(), peer->inbound_reader().bytes_buffered(), data );
+    expect( data == "request " + to_string( i ), "connection " + to_string( i ) + " received the wrong data" );
+    expect( peer->inbound_reader().is_finished(), "connection should have finished its inbound stream" );
+    peer->outbound_writer().push( "response " + to_string( i ) );
+    peer->outbound_writer().close();
+    server.push( at_server( i ) );
+  }
+  network.run();
+
+  for ( uint16_t i = 0; i < connections; i++ ) {
+    string data;
+    read( client_peers[i]->inbound_reader(), client_peers[i]->inbound_reader().bytes_buffered(), data );
+    expect( data == "response " + to_string( i ), "connection " + to_string( i ) + " got the wrong response" );
+  }
+
+  // a segment for no connection is dropped
+  TCPOverIPv4Adapter stranger;
+  stranger.config_mut().source = Address { "10.0.0.3", 1234 };
+  stranger.config_mut().destination = network.server_address;
+  TCPSenderMessage data;
+  data.payload = string { "hello" };
+  server.receive( clone( stranger.wrap_tcp_in_ip( { move( data ), TCPReceiverMessage {} } ) ) ); // owned, to parse
+  expect( server.unmatched_segments() == 1, "segment for no connection should be counted as unmatched" );
+  expect( server.connection_count() == connections, "segment for no connection should not create one" );
+
+  // once both sides have finished (and the side that has to linger is done), connections are forgotten
+  client.tick( 10UL * network.cfg.rt_timeout );
+  server.tick( 10UL * network.cfg.rt_timeout );
+  network.run();
+  expect( client.connection_count() == 0, "client should forget finished connections" );
+  expect( server.connection_count() == 0, "server should forget finished connections" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    four_tuple_map( 0 );
+    four_tuple_map( 0x243f6a8885a308d3 );
+    four_tuple_hash_seed();
+    many_connections();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,232 @@
+#include "demux_test_harness.hh"
+#include "helpers.hh"
+#include "tcp_demux.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// A server and a client, both using Fast Open
+struct Network : DemuxNetwork
+{
+  Network() : DemuxNetwork( fast_open_config() ) { server.listen( 80 ); }
+
+  static TCPConfig fast_open_config()
+  {
+    TCPConfig config;
+    config.fast_open = true;
+    return config;
+  }
+
+  // Open a connection from `port` and write a request to it (sent on the SYN if we hold a cookie)
+  TCPPeer& request( uint16_t port, const string& data )
+  {
+    TCPPeer& peer = client.connect( Address { "10.0.0.2", port }, server_address );
+    peer.outbound_writer().push( data );
+    client.push( at_client( port ) );
+    return peer;
+  }
+
+  string received_at_server( uint16_t port )
+  {
+    TCPPeer* peer = server.find( at_server( port ) );
+    expect( peer != nullptr, "server should have the connection" );
+    string data;
+    read( peer->inbound_reader(), peer->inbound_reader().bytes_buffered(), data );
+    return data;
+  }
+};
+
+void cookie_exchange()
+{
+  Network net;
+
+  // Without a cookie, the client asks for one; the SYN is sent at once, and the data after the handshake.
+  TCPPeer& first = net.request( 1000, "first" );
+  expect( net.to_server.size() == 1, "client should send its SYN" );
+  net.run();
+  expect( net.client.fast_open_cache().find( net.server_ip ).has_value(), "client should keep the cookie" );
+  expect( net.received_at_server( 1000 ) == "first", "server should get the first request" );
+  expect( first.sender().sequence_numbers_in_flight() == 0, "first request should be acknowledged" );
+
+  // With the cookie, the SYN waits for the data and carries it: the server has the request before the
+  // handshake completes.
+  TCPPeer& second = net.client.connect( Address { "10.0.0.2", 1001 }, net.server_address );
+  expect( net.to_server.empty(), "SYN should wait for data" );
+  second.outbound_writer().push( "second" );
+  net.client.push( net.at_client( 1001 ) );
+  expect( net.to_server.size() == 1, "client should send one SYN with the data" );
+  Network::deliver( net.to_server, net.server );
+  expect( net.server.find( net.at_server( 1001 ) )->fast_open_accepted(), "server should accept the cookie" );
+  expect( net.received_at_server( 1001 ) == "second", "server should take the data on the SYN" );
+
+  // The SYN-ACK acknowledges the data too, so the client has nothing to send again.
+  Network::deliver( net.to_client, net.client );
+  expect( second.sender().sequence_numbers_in_flight() == 0, "SYN-ACK should acknowledge the data" );
+  expect( second.sender().retransmitted_segments() == 0, "nothing should be sent again" );
+  net.run();
+
+  // A request and its end fit on one SYN.
+  TCPPeer& third = net.client.connect( Address { "10.0.0.2", 1002 }, net.server_address );
+  third.outbound_writer().push( "third" );
+  third.outbound_writer().close();
+  net.client.push( net.at_client( 1002 ) );
+  expect( net.to_server.size() == 1, "SYN should carry the request and FIN" );
+  Network::deliver( net.to_server, net.server );
+  expect( net.received_at_server( 1002 ) == "third", "server should take the data on the SYN" );
+  expect( net.server.find( net.at_server( 1002 ) )->inbound_reader().is_finished(), "SYN should carry the FIN" );
+}
+
+void invalid_cookie()
+{
+  Network net;
+  net.client.fast_open_cache().store( net.server_ip, "forged!!" );
+
+  // A SYN with a cookie the server didn't issue gets its data dropped, and the SYN-ACK issues a real cookie.
+  TCPPeer& peer = net.request( 2000, "request" );
+  expect( net.to_server.size() == 1, "client should send its SYN with the data" );
+  Network::deliver( net.to_server, net.server );
+  expect( not net.server.find( net.at_server( 2000 ) )->fast_open_accepted(), "forged cookie should be refused" );
+  expect( net.received_at_server( 2000 ).empty(), "server should not take data with a forged cookie" );
+
+  // The client sends the data again once the SYN is acknowledged, and keeps the new cookie.
+  Network::deliver( net.to_client, net.client );
+  expect( peer.sender().retransmitted_segments() == 1, "client should send the data again" );
+  net.run();
+  expect( net.received_at_server( 2000 ) == "request", "server should get the data after the handshake" );
+  expect( peer.sender().sequence_numbers_in_flight() == 0, "data should be acknowledged" );
+  const auto cookie = net.client.fast_open_cache().find( net.server_ip );
+  expect( cookie.has_value() and *cookie != "forged!!", "client should replace the forged cookie" );
+
+  // The new cookie works.
+  net.request( 2001, "again" );
+  Network::deliver( net.to_server, net.server );
+  expect( net.received_at_server( 2001 ) == "again", "server should take the data with the new cookie" );
+}
+
+// A cookie is good only from the address it was issued to: another client that learns it gets no data taken.
+void cookie_from_another_address()
+{
+  Network net;
+  net.request( 4000, "first" );
+  net.run();
+  expect( net.client.fast_open_cache().find( net.server_ip ).has_value(), "client should keep the cookie" );
+
+  // The same cache (so the same cookie), but the SYN comes from another address.
+  const Address elsewhere { "10.0.0.3", 4001 };
+  const FourTuple at_server { elsewhere.ipv4_numeric(), 4001, net.server_ip, 80 };
+  net.client.connect( elsewhere, net.server_address ).outbound_writer().push( "stolen" );
+  net.client.push( at_server.reversed() );
+  expect( net.to_server.size() == 1, "client should send its SYN with the data" );
+  Network::deliver( net.to_server, net.server );
+  TCPPeer* peer = net.server.find( at_server );
+  expect( peer != nullptr and not peer->fast_open_accepted(), "cookie from another address should be refused" );
+  expect( peer->inbound_reader().bytes_buffered() == 0, "server should not take data with another's cookie" );
+
+  // The data still arrives after the handshake.
+  net.run();
+  string data;
+  read( peer->inbound_reader(), peer->inbound_reader().bytes_buffered(), data );
+  expect( data == "stolen", "server should get the data after the handshake" );
+}
+
+// With a cookie, a client that only reads (the server speaks first) can't hold its SYN back for data to carry:
+// the SYN goes out alone on the first tick after time has passed.
+void server_speaks_first()
+{
+  Network net;
+  net.request( 5000, "first" );
+  net.run();
+  expect( net.client.fast_open_cache().find( net.server_ip ).has_value(), "client should keep the cookie" );
+
+  TCPPeer& peer = net.client.connect( Address { "10.0.0.2", 5001 }, net.server_address );
+  net.client.tick( 0 );
+  expect( net.to_server.empty(), "SYN should wait for data while no time has passed" );
+  net.client.tick( 1 );
+  expect( net.to_server.size() == 1, "SYN should go out on the first tick, without data" );
+  net.run();
+  expect( peer.established(), "client should finish the handshake" );
+
+  TCPPeer* server_peer = net.server.find( net.at_server( 5001 ) );
+  expect( server_peer != nullptr and server_peer->established(), "server should finish the handshake" );
+  server_peer->outbound_writer().push( "220 ready" );
+  net.server.push( net.at_server( 5001 ) );
+  net.run();
+  string greeting;
+  read( peer.inbound_reader(), peer.inbound_reader().bytes_buffered(), greeting );
+  expect( greeting == "220 ready", "client should read the server's greeting" );
+}
+
+// A SYN with every option and the longest cookie still fits them all in the 40 bytes of option space.
+void all_syn_options()
+{
+  TCPOverIPv4Adapter adapter;
+  adapter.config_mut().source = Address { "10.0.0.2", 5000 };
+  adapter.config_mut().destination = Address { "10.0.0.1", 80 };
+  TCPSenderMessage syn;
+  syn.SYN = true;
+  syn.tsval = 12345;
+  TCPReceiverMessage options;
+  options.sack_permitted = true;
+  options.window_scale = 7;
+  options.mss = 1460;
+  options.tsecr = 0;
+  const string cookie( TCPReceiverMessage::MAX_FAST_OPEN_COOKIE, 'c' );
+  options.fast_open_cookie = cookie;
+
+  InternetDatagram ip_dgram = clone( adapter.wrap_tcp_in_ip( { move( syn ), move( options ) } ) );
+  const optional<TCPSegment> seg = TCPOverIPv4Adapter::parse_tcp_in_ip( ip_dgram );
+  expect( seg.has_value(), "SYN with every option should parse" );
+  const TCPMessage& parsed = seg->message;
+  expect( parsed.sender->SYN and parsed.sender->tsval == 12345, "SYN should keep its timestamp" );
+  expect( parsed.receiver->sack_permitted, "SYN should keep SACK-permitted" );
+  expect( parsed.receiver->window_scale == 7, "SYN should keep its window scale" );
+  expect( parsed.receiver->mss == 1460, "SYN should keep its MSS" );
+  expect( parsed.receiver->fast_open_cookie == cookie, "SYN should keep its Fast Open cookie" );
+}
+
+// Without Fast Open on the server, SYN data waits for the handshake as before, and no cookie is issued.
+void server_without_fast_open()
+{
+  Network net;
+  TCPConfig plain;
+  TCPOverIPv4Demultiplexer server { plain, Network::writer( net.to_client ) };
+  server.listen( 80 );
+
+  net.client.connect( Address { "10.0.0.2", 3000 }, net.server_address ).outbound_writer().push( "hello" );
+  net.client.push( net.at_client( 3000 ) );
+  while ( not net.to_server.empty() or not net.to_client.empty() ) {
+    Network::deliver( net.to_server, server );
+    Network::deliver( net.to_client, net.client );
+  }
+  expect( not net.client.fast_open_cache().find( net.server_ip ).has_value(), "no cookie should be issued" );
+  string data;
+  TCPPeer* peer = server.find( net.at_server( 3000 ) );
+  read( peer->inbound_reader(), peer->inbound_reader().bytes_buffered(), data );
+  expect( data == "hello", "server should get the data" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    cookie_exchange();
+    invalid_cookie();
+    cookie_from_another_address();
+    server_speaks_first();
+    server_without_fast_open();
+    all_syn_options();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+#include "demux_test_harness.hh"
+#include "helpers.hh"
+#include "tcp_demux.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr size_t BACKLOG = 4;
+constexpr uint16_t FIRST_PORT = 20000;
+
+// A listening server and a client with many connections to it
+struct Network : DemuxNetwork
+{
+  vector<TCPPeer*> client_peers {};
+
+  // Open a connection from port FIRST_PORT + i, with a request ready to send once it is established
+  void connect( uint16_t i )
+  {
+    client_peers.push_back(
+      &client.connect( Address { "10.0.0.2", static_cast<uint16_t>( FIRST_PORT + i ) }, server_address ) );
+    client_peers.back()->outbound_writer().push( "request " + to_string( i ) );
+  }
+
+  // Take every connection waiting in the accept queue, and check that each got its client's request
+  set<uint16_t> accept_all()
+  {
+    set<uint16_t> accepted;
+    while ( auto addresses = server.accept( 80 ) ) {
+      const uint16_t i = addresses->src_port - FIRST_PORT;
+      TCPPeer* peer = server.find( *addresses );
+      expect( peer != nullptr and peer->established(), "accepted connection should be established" );
+      string data;
+      read( peer->inbound_reader(), peer->inbound_reader().bytes_buffered(), data );
+      expect( data == "request " + to_string( i ), "connection " + to_string( i ) + " received the wrong data" );
+      accepted.insert( i );
+    }
+    return accepted;
+  }
+};
+
+void backlog_and_cookies()
+{
+  constexpr uint16_t connections = 10;
+  Network net;
+  net.server.listen( 80, BACKLOG );
+  for ( uint16_t i = 0; i < connections; i++ ) {
+    net.connect( i );
+  }
+
+  // Only the SYNs that find room among the half-open connections get state; the rest get SYN cookies.
+  Network::deliver( net.to_server, net.server );
+  expect( net.server.connection_count() == BACKLOG, "only the backlog should be half-open" );
+  expect( net.server.syn_cookies_sent() == connections - BACKLOG,
+          "the other SYNs should be answered with cookies" );
+  expect( not net.server.accept( 80 ).has_value(), "no connection should be established yet" );
+
+  // The cookies' handshakes complete, but the accept queue is already full of the stateful connections.
+  net.run();
+  expect( net.server.syn_cookies_accepted() == 0, "a full accept queue should take no more connections" );
+  expect( net.server.listen_overflows() == connections - BACKLOG, "cookie handshakes should overflow the queue" );
+  set<uint16_t> accepted = net.accept_all();
+  expect( accepted.size() == BACKLOG, "the stateful connections should be accepted" );
+
+  // The clients retransmit their requests, which carry the ACK of the cookie, so the accept queue refills.
+  uint64_t elapsed = 0;
+  while ( accepted.size() < connections ) {
+    expect( elapsed < 10 * 1000, "every connection should eventually be accepted" );
+    net.client.tick( net.cfg.rt_timeout );
+    net.server.tick( net.cfg.rt_timeout );
+    elapsed += net.cfg.rt_timeout;
+    net.run();
+    const set<uint16_t> more = net.accept_all();
+    expect( more.size() <= BACKLOG, "at most the backlog should wait to be accepted" );
+    accepted.insert( more.begin(), more.end() );
+  }
+  expect( net.server.syn_cookies_accepted() == connections - BACKLOG, "each cookie should start a connection" );
+
+  // Connections started from a cookie work like any other.
+  for ( uint16_t i = 0; i < connections; i++ ) {
+    const FourTuple at_server = net.at_server( FIRST_PORT + i );
+    TCPPeer* peer = net.server.find( at_server );
+    peer->outbound_writer().push( "response " + to_string( i ) );
+    net.server.push( at_server );
+  }
+  net.run();
+  for ( uint16_t i = 0; i < connections; i++ ) {
+    string data;
+    read( net.client_peers[i]->inbound_reader(), net.client_peers[i]->inbound_reader().bytes_buffered(), data );
+    expect( data == "response " + to_string( i ), "connection " + to_string( i ) + " got the wrong response" );
+  }
+}
+
+void invalid_cookies()
+{
+  Network net;
+  net.server.listen( 80, 1 );
+  net.connect( 0 );
+  net.connect( 1 );
+  Network::deliver( net.to_server, net.server );
+  expect( net.server.syn_cookies_sent() == 1, "the second SYN should be answered with a cookie" );
+
+  // An ACK that acknowledges no cookie starts nothing.
+  Network::deliver( net.to_client, net.client );
+  const uint64_t unmatched = net.server.unmatched_segments();
+  for ( auto& datagram : net.to_server ) {
+    InternetDatagram ip_dgram;
+    expect( parse( ip_dgram, vector<string> { move( datagram ) } ), "datagram should parse" );
+    auto segment = TCPOverIPv4Demultiplexer::parse_segment( move( ip_dgram ) );
+    expect( segment.has_value(), "segment should parse" );
+    if ( segment->first.src_port == FIRST_PORT + 1 ) {
+      segment->second.receiver->ackno = *segment->second.receiver->ackno + 1;
+    }
+    net.server.receive( segment->first, move( segment->second ) );
+  }
+  net.to_server.clear();
+  expect( net.server.connection_count() == 1, "a forged cookie should not start a connection" );
+  expect( net.server.unmatched_segments() > unmatched, "a forged cookie should be counted as unmatched" );
+
+  // A cookie made more than two periods ago has expired.
+  Network net2;
+  net2.server.listen( 80, 1 );
+  net2.connect( 0 );
+  net2.connect( 1 );
+  Network::deliver( net2.to_server, net2.server );
+  Network::deliver( net2.to_client, net2.client );
+  net2.server.tick( 3 * 64 * 1000 );
+  Network::deliver( net2.to_server, net2.server );
+  expect( net2.server.syn_cookies_accepted() == 0, "an expired cookie should not start a connection" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    backlog_and_cookies();
+    invalid_cookies();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,211 @@
+#include "demux_test_harness.hh"
+#include "exception.hh"
+#include "helpers.hh"
+#include "tcp_shards.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr size_t SHARDS = 4;
+constexpr uint16_t CONNECTIONS = 200;
+constexpr uint16_t FIRST_PORT = 20000;
+
+// The client's side of a multi-queue interface, each queue a Unix-domain socket pair. The client writes its
+// datagrams to the queues in turn, without regard to which shard owns the connection, as the kernel's own
+// flow steering would.
+struct Queues
+{
+  vector<FileDescriptor> client_ends {};
+  vector<FileDescriptor> stack_ends {};
+  size_t next {};
+
+  Queues()
+  {
+    for ( size_t i = 0; i < SHARDS; i++ ) {
+      array<int, 2> fds {};
+      CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_SEQPACKET, 0, fds.data() ) );
+      client_ends.emplace_back( fds[0] );
+      stack_ends.emplace_back( fds[1] );
+    }
+  }
+
+  TCPOverIPv4Demultiplexer::DatagramWriter writer()
+  {
+    return [this]( const vector<string_view>& buffers ) {
+      client_ends[next].write( buffers );
+      next = ( next + 1 ) % client_ends.size();
+    };
+  }
+};
+
+// Run the client until `done` or a deadline
+void run_client( Queues& queues, TCPOverIPv4Demultiplexer& client, const function<bool()>& done )
+{
+  EventLoop loop;
+  for ( auto& fd : queues.client_ends ) {
+    loop.add_rule( "queue", fd, Direction::In, [&] {
+      if ( auto ip_dgram = read_ipv4_datagram( fd ) ) {
+        client.receive( move( *ip_dgram ) );
+      }
+    } );
+  }
+
+  const auto deadline = chrono::steady_clock::now() + chrono::seconds( 20 );
+  auto last_tick = chrono::steady_clock::now();
+  while ( not done() ) {
+    expect( chrono::steady_clock::now() < deadline, "timed out" );
+    loop.wait_next_event( 1 );
+    const auto now = chrono::steady_clock::now();
+    client.tick( chrono::duration_cast<chrono::milliseconds>( now - last_tick ).count() );
+    last_tick = now;
+  }
+}
+
+void sharded_server()
+{
+  const Address server_address { "10.0.0.1", 80 };
+  const uint32_t server_ip = server_address.ipv4_numeric();
+  const uint32_t client_ip = Address { "10.0.0.2", 0 }.ipv4_numeric();
+  const auto at_server
+    = [&]( uint16_t i ) { return FourTuple { client_ip, static_cast<uint16_t>( FIRST_PORT + i ), server_ip, 80 }; };
+  const auto at_client = [&]( uint16_t i ) { return at_server( i ).reversed(); };
+
+  // written by the shards' threads (and declared before the stack, which joins them)
+  mutex server_mutex;
+  map<uint16_t, thread::id> accepted_on;
+  size_t answered = 0;
+  vector<string> failures;
+
+  Queues queues;
+  TCPConfig cfg;
+  TCPOverIPv4Demultiplexer client { cfg, queues.writer() };
+  ShardedTCPOverIPv4Stack stack { cfg, move( queues.stack_ends ) };
+  expect( stack.shard_count() == SHARDS, "stack should have a shard per queue" );
+
+  stack.listen( 80, [&]( const FourTuple& addresses, TCPPeer& /*peer*/ ) {
+    const lock_guard lock { server_mutex };
+    accepted_on.emplace( addresses.src_port - FIRST_PORT, this_thread::get_id() );
+  } );
+
+  vector<TCPPeer*> client_peers;
+  for ( uint16_t i = 0; i < CONNECTIONS; i++ ) {
+    client_peers.push_back(
+      &client.connect( Address { "10.0.0.2", static_cast<uint16_t>( FIRST_PORT + i ) }, server_address ) );
+    client_peers.back()->outbound_writer().push( "request " + to_string( i ) );
+    client_peers.back()->outbound_writer().close();
+  }
+  run_client( queues, client, [&] {
+    for ( const auto* peer : client_peers ) {
+      if ( peer->sender().sequence_numbers_in_flight() > 0 or not peer->has_ackno() ) {
+        return false;
+      }
+    }
+    return true;
+  } );
+
+  {
+    const lock_guard lock { server_mutex };
+    expect( accepted_on.size() == CONNECTIONS, "server should accept every connection" );
+    set<thread::id> threads;
+    for ( const auto& [i, id] : accepted_on ) {
+      threads.insert( id );
+    }
+    expect( threads.size() == SHARDS, "connections should be spread across every shard" );
+  }
+
+  // Each connection answers on the thread of the shard that accepted it.
+  for ( uint16_t i = 0; i < CONNECTIONS; i++ ) {
+    stack.post( at_server( i ), [&, i]( TCPOverIPv4Demultiplexer& demux ) {
+      const lock_guard lock { server_mutex };
+      if ( accepted_on.at( i ) != this_thread::get_id() ) {
+        failures.push_back( "connection " + to_string( i ) + " moved off the shard that accepted it" );
+      }
+      TCPPeer* peer = demux.find( at_server( i ) );
+      if ( peer == nullptr ) {
+        failures.push_back( "shard should own connection " + to_string( i ) );
+        return;
+      }
+      string data;
+      read( peer->inbound_reader(), peer->inbound_reader().bytes_buffered(), data );
+      if ( data != "request " + to_string( i ) ) {
+        failures.push_back( "connection " + to_string( i ) + " received the wrong data" );
+      }
+      peer->outbound_writer().push( "response " + to_string( i ) );
+      peer->outbound_writer().close();
+      demux.push( at_server( i ) );
+      answered++;
+    } );
+  }
+
+  vector<string> responses( CONNECTIONS );
+  run_client( queues, client, [&] {
+    bool finished = true;
+    for ( uint16_t i = 0; i < CONNECTIONS; i++ ) {
+      Reader& reader = client_peers[i]->inbound_reader();
+      string data;
+      read( reader, reader.bytes_buffered(), data );
+      responses[i] += data;
+      finished = finished and reader.is_finished();
+    }
+    return finished;
+  } );
+
+  {
+    const lock_guard lock { server_mutex };
+    expect( failures.empty(), failures.empty() ? "" : failures.front() );
+    expect( answered == CONNECTIONS, "every connection should be answered" );
+  }
+  for ( uint16_t i = 0; i < CONNECTIONS; i++ ) {
+    expect( responses[i] == "response " + to_string( i ),
+            "connection " + to_string( i ) + " got the wrong response" );
+    expect( client.find( at_client( i ) ) == client_peers[i], "client should still have connection" );
+  }
+  expect( stack.handed_off_segments() > 0, "segments arriving on another shard's queue should be handed off" );
+}
+
+// Connections opened by the stack are owned by the shard their four-tuple hashes to.
+void sharded_client()
+{
+  const Address server_address { "10.0.0.1", 80 };
+  Queues queues;
+  TCPConfig cfg;
+  TCPOverIPv4Demultiplexer server { cfg, queues.writer() };
+  size_t accepted = 0;
+  server.listen( 80, [&]( const FourTuple& /*addresses*/, TCPPeer& /*peer*/ ) { accepted++; } );
+
+  ShardedTCPOverIPv4Stack stack { cfg, move( queues.stack_ends ) };
+  for ( uint16_t i = 0; i < CONNECTIONS; i++ ) {
+    stack.connect( Address { "10.0.0.2", static_cast<uint16_t>( FIRST_PORT + i ) }, server_address );
+  }
+  run_client( queues, server, [&] { return accepted == CONNECTIONS; } );
+  expect( server.connection_count() == CONNECTIONS, "server should have every connection" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    sharded_server();
+    sharded_client();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
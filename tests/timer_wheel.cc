@@ -0,0 +1,137 @@
+#include "demux_test_harness.hh"
+#include "timer_wheel.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+void basics()
+{
+  TimerWheel<int> wheel;
+  vector<int> fired;
+  const auto record = [&]( int value ) { fired.push_back( value ); };
+
+  wheel.schedule( 5, 1 );
+  const auto cancelled = wheel.schedule( 5, 2 );
+  wheel.schedule( 70, 3 );     // on the second wheel
+  wheel.schedule( 5000, 4 );   // on the third
+  wheel.schedule( 300000, 5 ); // on the fourth
+  expect( wheel.size() == 5, "wheel should hold five timers" );
+  expect( wheel.cancel( cancelled ), "pending timer should be cancelled" );
+  expect( not wheel.cancel( cancelled ), "cancelled timer should not be cancelled again" );
+
+  wheel.advance( 4, record );
+  expect( fired.empty(), "no timer is due before 5 ms" );
+  wheel.advance( 1, record );
+  expect( fired == vector<int> { 1 }, "timer due at 5 ms should fire at 5 ms" );
+  wheel.advance( 64, record );
+  expect( fired == vector<int> { 1 }, "timer due at 70 ms should not fire at 69 ms" );
+  wheel.advance( 1, record );
+  expect( fired == vector<int> { 1, 3 }, "timer due at 70 ms should fire at 70 ms" );
+  wheel.advance( 5000 - 70, record );
+  expect( fired == vector<int> { 1, 3, 4 }, "timer due at 5000 ms should fire at 5000 ms" );
+  wheel.advance( 300000 - 5001, record );
+  expect( fired.size() == 3, "timer due at 300000 ms should not fire early" );
+  wheel.advance( 1, record );
+  expect( fired.back() == 5 and wheel.empty(), "timer due at 300000 ms should fire at 300000 ms" );
+
+  // A deadline that has passed expires on the next millisecond.
+  wheel.schedule( 0, 6 );
+  wheel.advance( 1, record );
+  expect( fired.back() == 6, "past deadline should expire on the next millisecond" );
+
+  // With nothing pending, the clock moves at once.
+  wheel.advance( 1'000'000'000, record );
+  expect( wheel.now() == 1'000'300'001, "empty wheel should advance its clock" );
+}
+
+// A timer may schedule and cancel timers as it expires, including ones due in the same millisecond.
+void reentrant()
+{
+  TimerWheel<int> wheel;
+  vector<pair<int, uint64_t>> fired;
+  TimerWheel<int>::TimerId victim = wheel.schedule( 10, 2 );
+  wheel.schedule( 10, 1 );
+  wheel.advance( 20, [&]( int value ) {
+    fired.emplace_back( value, wheel.now() );
+    if ( value == 1 ) {
+      wheel.cancel( victim );
+      wheel.schedule( wheel.now() + 3, 3 );
+    }
+  } );
+  // timers due in the same millisecond fire in no particular order, so 2 may have fired before 1
+  const bool cancelled = fired.size() == 2 and fired[0] == pair<int, uint64_t> { 1, 10 };
+  const bool fired_first = fired.size() == 3 and fired[0] == pair<int, uint64_t> { 2, 10 };
+  expect( cancelled or fired_first, "a timer cancelled by an earlier one in the same millisecond should not fire" );
+  expect( fired.back() == pair<int, uint64_t> { 3, 13 }, "a timer scheduled as another expires should fire" );
+}
+
+// Random timers, beyond the range of the wheels, against a map of deadlines.
+void random_timers()
+{
+  default_random_engine rng { 144 };
+  TimerWheel<uint32_t> wheel;
+  map<uint32_t, pair<uint64_t, TimerWheel<uint32_t>::TimerId>> expected; // value -> deadline and id
+  uint32_t next_value = 0;
+  uint64_t fired = 0;
+
+  const auto expire = [&]( uint32_t value ) {
+    auto it = expected.find( value );
+    expect( it != expected.end(), "expired timer should be pending" );
+    expect( it->second.first == wheel.now(), "timer should expire at its deadline" );
+    expected.erase( it );
+    fired++;
+  };
+
+  for ( int round = 0; round < 2000; round++ ) {
+    for ( int i = 0; i < 10; i++ ) {
+      const uint32_t magnitude = uniform_int_distribution<uint32_t> { 0, 25 }( rng );
+      const uint64_t delay = 1 + uniform_int_distribution<uint64_t> { 0, ( uint64_t { 1 } << magnitude ) }( rng );
+      const uint64_t deadline = wheel.now() + delay;
+      expected[next_value] = { deadline, wheel.schedule( deadline, next_value ) };
+      next_value++;
+    }
+    if ( not expected.empty() and uniform_int_distribution<int> { 0, 2 }( rng ) == 0 ) {
+      auto it = expected.begin();
+      advance( it, uniform_int_distribution<size_t> { 0, expected.size() - 1 }( rng ) );
+      expect( wheel.cancel( it->second.second ), "pending timer should be cancelled" );
+      expected.erase( it );
+    }
+    wheel.advance( uniform_int_distribution<uint64_t> { 0, 20000 }( rng ), expire );
+    expect( wheel.size() == expected.size(), "wheel should hold the pending timers" );
+  }
+
+  uint64_t last = 0;
+  for ( const auto& [value, timer] : expected ) {
+    last = max( last, timer.first );
+  }
+  wheel.advance( last - wheel.now(), expire );
+  expect( expected.empty() and wheel.empty(), "every timer should have expired" );
+  expect( fired > 0, "timers should have fired along the way" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    basics();
+    reentrant();
+    random_timers();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
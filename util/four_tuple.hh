@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//! \brief The addresses and ports that identify a TCP connection, as seen on a segment arriving from the peer
+struct FourTuple
+{
+  uint32_t src_ip {};
+  uint16_t src_port {};
+  uint32_t dst_ip {};
+  uint16_t dst_port {};
+
+  //! The same connection as seen on a segment going to the peer
+  FourTuple reversed() const { return { dst_ip, dst_port, src_ip, src_port }; }
+
+  bool operator==( const FourTuple& other ) const = default;
+
+  //! A well-mixed 64-bit hash (the finalizer of SplitMix64), so that nearby addresses and ports spread out.
+  //! A secret `seed` keeps a remote host from choosing four-tuples that collide.
+  uint64_t hash( uint64_t seed = 0 ) const
+  {
+    uint64_t h = ( static_cast<uint64_t>( src_ip ) << 32 | dst_ip )
+                 ^ ( static_cast<uint64_t>( src_port ) << 16 | dst_port ) * 0x9e3779b97f4a7c15 ^ seed;
+    h = ( h ^ ( h >> 30 ) ) * 0xbf58476d1ce4e5b9;
+    h = ( h ^ ( h >> 27 ) ) * 0x94d049bb133111eb;
+    return h ^ ( h >> 31 );
+  }
+};
+
+/*
+ * A hash map from FourTuple to a small value (such as an index into a table of connections).
+ *
+ * Keys and values live side by side in one flat array, found by linear probing, so a lookup usually
+ * touches a single cache line. The table stays at most half full, and erasing shifts later entries
+ * back into the hole instead of leaving a tombstone, so probe sequences stay short as connections
+ * come and go.
+ *
+ * Each map may hash with its own `seed`; a map that holds keys chosen by remote hosts should use a
+ * random one, so that nobody can predict which four-tuples share a probe run.
+ */
+template<typename T>
+class FourTupleMap
+{
+public:
+  explicit FourTupleMap( uint64_t seed = 0 ) : seed_( seed ) {}
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  //! The value stored for `key`, or nullptr
+  T* find( const FourTuple& key )
+  {
+    if ( slots_.empty() ) {
+      return nullptr;
+    }
+    for ( size_t i = key.hash( seed_ ) & mask(); slots_[i].used; i = ( i + 1 ) & mask() ) {
+      if ( slots_[i].key == key ) {
+        return &slots_[i].value;
+      }
+    }
+    return nullptr;
+  }
+  const T* find( const FourTuple& key ) const { return const_cast<FourTupleMap*>( this )->find( key ); }
+
+  //! Store `value` for `key` unless the key is already present. Returns the stored value, and whether it is new.
+  std::pair<T*, bool> insert( const FourTuple& key, T value )
+  {
+    if ( 2 * ( size_ + 1 ) > slots_.size() ) {
+      rehash( std::max( MIN_CAPACITY, 2 * slots_.size() ) );
+    }
+
+    size_t i = key.hash( seed_ ) & mask();
+    for ( ; slots_[i].used; i = ( i + 1 ) & mask() ) {
+      if ( slots_[i].key == key ) {
+        return { &slots_[i].value, false };
+      }
+    }
+    slots_[i] = { key, std::move( value ), true };
+    size_++;
+    return { &slots_[i].value, true };
+  }
+
+  //! Remove `key`; returns whether it was present
+  bool erase( const FourTuple& key )
+  {
+    if ( slots_.empty() ) {
+      return false;
+    }
+
+    size_t hole = key.hash( seed_ ) & mask();
+    while ( slots_[hole].used and not( slots_[hole].key == key ) ) {
+      hole = ( hole + 1 ) & mask();
+    }
+    if ( not slots_[hole].used ) {
+      return false;
+    }
+
+    // Move each later entry of the probe run into the hole, if the hole lies between its home slot and it.
+    for ( size_t i = ( hole + 1 ) & mask(); slots_[i].used; i = ( i + 1 ) & mask() ) {
+      const size_t home = slots_[i].key.hash( seed_ ) & mask();
+      if ( ( ( i - home ) & mask() ) >= ( ( i - hole ) & mask() ) ) {
+        slots_[hole] = std::move( slots_[i] );
+        hole = i;
+      }
+    }
+    slots_[hole].used = false;
+    size_--;
+    return true;
+  }
+
+private:
+  static constexpr size_t MIN_CAPACITY = 16;
+
+  struct Slot
+  {
+    FourTuple key {};
+    T value {};
+    bool used {};
+  };
+
+  uint64_t seed_;
+  std::vector<Slot> slots_ {}; // capacity is a power of two
+  size_t size_ {};
+
+  size_t mask() const { return slots_.size() - 1; }
+
+  void rehash( size_t capacity )
+  {
+    std::vector<Slot> old = std::exchange( slots_, std::vector<Slot>( capacity ) );
+    size_ = 0;
+    for ( auto& slot : old ) {
+      if ( slot.used ) {
+        insert( slot.key, std::move( slot.value ) );
+      }
+    }
+  }
+};
@@ -36,7 +36,7 @@ struct IPv4Header
   // IPv4 Header fields
   uint8_t ver = 4;           // IP version
   uint8_t hlen = LENGTH / 4; // header length (multiples of 32 bits)
-  uint8_t tos = 0;           // type of service
+  uint8_t tos = 0;           // type of service (the low two bits are the ECN field)
   uint16_t len = 0;          // total length of packet
   uint16_t id = 0;           // identification number
   bool df = true;            // don't fragment flag
@@ -7,7 +7,9 @@
 
 #include <optional>
 #include <random>
+#include <span>
 #include <utility>
+#include <vector>
 
 //! An adapter class that adds random dropping behavior to an FD adapter
 template<typename AdapterT>
@@ -20,6 +22,9 @@ private:
   //! The underlying FD adapter
   AdapterT _adapter;
 
+  //! Datagrams of the current batch that were not dropped (reused across calls)
+  std::vector<TCPMessage> _surviving {};
+
   //! \brief Determine whether or not to drop a given read or write
   //! \param[in] uplink is `true` to use the uplink loss probability, else use the downlink loss probability
   //! \returns `true` if the segment should be dropped
@@ -59,6 +64,19 @@ public:
     return _adapter.write( seg );
   }
 
+  //! \brief Write a batch to the underlying AdapterT instance, dropping each datagram independently
+  //! \param[in] batch is the packets to either write or drop
+  void write_batch( std::span<const TCPMessage> batch )
+  {
+    _surviving.clear();
+    for ( const auto& seg : batch ) {
+      if ( not _should_drop( true ) ) {
+        _surviving.push_back( { seg.sender.borrow(), seg.receiver.borrow() } );
+      }
+    }
+    _adapter.write_batch( _surviving );
+  }
+
   //! \name
   //! Passthrough functions to the underlying AdapterT instance
 
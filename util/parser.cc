@@ -84,6 +84,26 @@ void Parser::BufferList::dump_all( vector<Ref<std::string>>& out )
   }
 }
 
+void Parser::BufferList::dump_all( Slice& out )
+{
+  if ( empty() ) {
+    out = {};
+  } else if ( buffer_.size() == 1 ) {
+    out = Slice { buffer_.front().release() }.substr( skip_ );
+  } else {
+    std::string concat;
+    concat.reserve( size_ );
+    for ( const auto& view : buffer() ) {
+      concat.append( view );
+    }
+    out = Slice { move( concat ) };
+  }
+
+  buffer_.clear();
+  size_ = 0;
+  skip_ = 0;
+}
+
 vector<string_view> Parser::BufferList::buffer() const
 {
   if ( empty() ) {
@@ -161,6 +181,15 @@ void Serializer::buffer( const vector<Ref<string>>& bufs )
   }
 }
 
+void Serializer::buffer( const Slice& buf )
+{
+  if ( const string* whole = buf.whole() ) {
+    buffer( Ref<string>::borrow( *whole ) );
+  } else {
+    buffer( static_cast<string>( buf ) );
+  }
+}
+
 vector<Ref<string>> Serializer::finish()
 {
   flush();
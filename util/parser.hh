@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ref.hh"
+#include "slice.hh"
 
 #include <concepts>
 #include <cstdint>
@@ -29,6 +30,10 @@ class Parser
         if ( buffer_.back().is_borrowed() ) {
           throw std::runtime_error( "cannot parse borrowed string" );
         }
+        if ( buffer_.back()->empty() ) {
+          buffer_.pop_back();
+          continue;
+        }
         size_ += buffer_.back()->size();
       }
     }
@@ -42,6 +47,7 @@ class Parser
     void remove_prefix( uint64_t len );
     void truncate( size_t len );
     void dump_all( std::vector<Ref<std::string>>& out );
+    void dump_all( Slice& out );
     std::vector<std::string_view> buffer() const;
   };
 
@@ -64,6 +70,9 @@ public:
   void truncate( size_t len ) { input_.truncate( len ); }
 
   void all_remaining( std::vector<Ref<std::string>>& out ) { input_.dump_all( out ); }
+
+  // The remaining input as one Slice: shares the buffer when it is a single one, otherwise concatenates.
+  void all_remaining( Slice& out ) { input_.dump_all( out ); }
   std::vector<std::string_view> buffer() const { return input_.buffer(); }
 
   void string( std::span<char> out );
@@ -114,5 +123,6 @@ public:
   void buffer( std::string buf );
   void buffer( Ref<std::string> buf );
   void buffer( const std::vector<Ref<std::string>>& bufs );
+  void buffer( const Slice& buf ); // borrows the Slice's string when it views all of it; otherwise copies
   std::vector<Ref<std::string>> finish();
 };
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+/*
+ * A process-wide budget for send-buffer memory beyond each connection's configured capacity.
+ *
+ * A TCPSender that autotunes its send buffer holds a Reservation for the bytes it has grown by.
+ * Growth is granted only while the total across all connections stays within the limit, and the
+ * bytes return to the budget when the buffer shrinks or the sender is destroyed.
+ */
+class SendBufferBudget
+{
+public:
+  static constexpr uint64_t DEFAULT_LIMIT = 64 * 1024 * 1024;
+
+  static void set_limit( uint64_t bytes ) { limit_ = bytes; }
+  static uint64_t limit() { return limit_; }
+  static uint64_t in_use() { return in_use_; }
+
+  class Reservation
+  {
+  public:
+    Reservation() = default;
+    Reservation( Reservation&& other ) noexcept : bytes_( std::exchange( other.bytes_, 0 ) ) {}
+    Reservation& operator=( Reservation&& other ) noexcept
+    {
+      if ( this != &other ) {
+        in_use_ -= bytes_;
+        bytes_ = std::exchange( other.bytes_, 0 );
+      }
+      return *this;
+    }
+    Reservation( const Reservation& other ) = delete;
+    Reservation& operator=( const Reservation& other ) = delete;
+    ~Reservation() { in_use_ -= bytes_; }
+
+    uint64_t bytes() const { return bytes_; }
+
+    // Grow or shrink the reservation to `bytes`. Growth stops at what is left of the budget;
+    // returns the size actually reserved.
+    uint64_t resize( uint64_t bytes )
+    {
+      if ( bytes <= bytes_ ) {
+        in_use_ -= bytes_ - bytes;
+        bytes_ = bytes;
+        return bytes_;
+      }
+
+      const uint64_t limit = limit_;
+      uint64_t used = in_use_;
+      uint64_t grant {};
+      do {
+        grant = std::min( bytes - bytes_, limit > used ? limit - used : 0 );
+      } while ( not in_use_.compare_exchange_weak( used, used + grant ) );
+      bytes_ += grant;
+      return bytes_;
+    }
+
+  private:
+    uint64_t bytes_ {};
+  };
+
+private:
+  static inline std::atomic<uint64_t> limit_ { DEFAULT_LIMIT };
+  static inline std::atomic<uint64_t> in_use_ {};
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/*
+ * A Slice is an immutable view of part of a reference-counted string.
+ *
+ * Copying a Slice, or taking a substring of one, shares the underlying bytes instead of copying them.
+ * The ByteStream keeps its buffered data as Slices, so the TCPSender can cut a segment's payload out
+ * of the stream in O(1), and keep it for retransmission without duplicating it.
+ */
+class Slice
+{
+public:
+  Slice() = default;
+
+  // take ownership of a string (moved in, not copied, when passed an rvalue)
+  Slice( std::string str ) // NOLINT(*-explicit-*)
+    : storage_( std::make_shared<const std::string>( std::move( str ) ) ), length_( storage_->size() )
+  {}
+
+  size_t size() const { return length_; }
+  bool empty() const { return length_ == 0; }
+
+  std::string_view view() const
+  {
+    return storage_ ? std::string_view { *storage_ }.substr( offset_, length_ ) : std::string_view {};
+  }
+
+  // the string this Slice views, if it views all of it (so it can be borrowed without a copy), else nullptr
+  const std::string* whole() const
+  {
+    return storage_ and offset_ == 0 and length_ == storage_->size() ? storage_.get() : nullptr;
+  }
+
+  operator std::string_view() const { return view(); } // NOLINT(*-explicit-*)
+  explicit operator std::string() const { return std::string { view() }; }
+
+  // the bytes [pos, pos + n), sharing this Slice's storage
+  Slice substr( size_t pos, size_t n = std::string_view::npos ) const
+  {
+    Slice ret { *this };
+    ret.offset_ += std::min( pos, length_ );
+    ret.length_ = std::min( n, length_ - std::min( pos, length_ ) );
+    return ret;
+  }
+
+  // Append another Slice. If `other` continues this one in the same storage, this is O(1);
+  // otherwise the two are copied into a new string.
+  Slice& operator+=( const Slice& other )
+  {
+    if ( other.empty() ) {
+      return *this;
+    }
+    if ( empty() ) {
+      return *this = other;
+    }
+    if ( storage_ == other.storage_ and offset_ + length_ == other.offset_ ) {
+      length_ += other.length_;
+      return *this;
+    }
+
+    std::string joined;
+    joined.reserve( length_ + other.length_ );
+    joined.append( view() );
+    joined.append( other.view() );
+    return *this = Slice { std::move( joined ) };
+  }
+
+  // Join a sequence of Slices. If each continues the previous one in the same storage, this is O(1);
+  // otherwise they are copied, once, into a new string.
+  static Slice join( std::span<const Slice> parts )
+  {
+    if ( parts.empty() ) {
+      return {};
+    }
+    size_t total = 0;
+    bool contiguous = true;
+    for ( size_t i = 0; i < parts.size(); i++ ) {
+      total += parts[i].length_;
+      if ( i > 0 ) {
+        const Slice& prev = parts[i - 1];
+        contiguous = contiguous and parts[i].storage_ == prev.storage_
+                     and prev.offset_ + prev.length_ == parts[i].offset_;
+      }
+    }
+    if ( contiguous ) {
+      Slice ret { parts.front() };
+      ret.length_ = total;
+      return ret;
+    }
+
+    std::string joined;
+    joined.reserve( total );
+    for ( const auto& part : parts ) {
+      joined.append( part.view() );
+    }
+    return Slice { std::move( joined ) };
+  }
+
+private:
+  std::shared_ptr<const std::string> storage_ {};
+  size_t offset_ {};
+  size_t length_ {};
+};
@@ -0,0 +1,69 @@
+#include "tcp_coalescer.hh"
+
+#include <utility>
+
+using namespace std;
+
+namespace {
+// A data segment that can start or extend a run
+bool is_plain_data( const TCPMessage& msg )
+{
+  return not msg.sender->SYN and not msg.sender->RST and not msg.sender->payload.empty() and not msg.sender->CWR
+         and not msg.receiver->RST and msg.receiver->sack.empty();
+}
+} // namespace
+
+bool TCPSegmentCoalescer::can_merge( const Pending& pending, const TCPMessage& msg ) const
+{
+  const TCPSenderMessage& head = pending.msg.sender.get();
+  const TCPSenderMessage& next = msg.sender.get();
+  const TCPReceiverMessage& head_ack = pending.msg.receiver.get();
+  const TCPReceiverMessage& next_ack = msg.receiver.get();
+
+  return is_plain_data( msg ) and not head.FIN
+         and next.seqno == head.seqno + static_cast<uint32_t>( pending.payload_size )
+         and pending.payload_size + next.payload.size() <= max_payload_ and next.tsval == head.tsval
+         and next.ecn == head.ecn and next_ack.ackno == head_ack.ackno
+         and next_ack.window_size == head_ack.window_size and next_ack.tsecr == head_ack.tsecr
+         and next_ack.ECE == head_ack.ECE;
+}
+
+void TCPSegmentCoalescer::add( const FourTuple& key, TCPMessage msg )
+{
+  segments_added_++;
+
+  if ( size_t* index = growing_.find( key ) ) {
+    Pending& pending = pending_[*index];
+    if ( can_merge( pending, msg ) ) {
+      pending.parts.push_back( msg.sender->payload );
+      pending.payload_size += msg.sender->payload.size();
+      if ( msg.sender->FIN ) {
+        pending.msg.sender->FIN = true;
+      }
+      return;
+    }
+    growing_.erase( key );
+  }
+
+  const bool plain_data = is_plain_data( msg );
+  const uint64_t payload_size = msg.sender->payload.size();
+  pending_.push_back( { key, move( msg ) } );
+  if ( plain_data ) {
+    pending_.back().payload_size = payload_size;
+    growing_.insert( key, pending_.size() - 1 );
+  }
+}
+
+void TCPSegmentCoalescer::flush( const DeliverFunction& deliver )
+{
+  vector<Pending> ready = exchange( pending_, {} );
+  for ( auto& pending : ready ) {
+    growing_.erase( pending.key );
+    if ( not pending.parts.empty() ) {
+      pending.parts.insert( pending.parts.begin(), pending.msg.sender->payload );
+      pending.msg.sender->payload = Slice::join( pending.parts );
+    }
+    segments_delivered_++;
+    deliver( pending.key, move( pending.msg ) );
+  }
+}
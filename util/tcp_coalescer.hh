@@ -0,0 +1,59 @@
+#pragma once
+
+#include "four_tuple.hh"
+#include "slice.hh"
+#include "tcp_segment.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ * Receive-side segment coalescing (software GRO).
+ *
+ * The segments read from the interface in one wakeup are added one at a time. A data segment that
+ * continues the pending segment of its connection exactly (next sequence number, same acknowledgment,
+ * window, flags and options) is merged into it, so the connection's TCPPeer receives, reassembles and
+ * decides whether to ACK once for the whole run. A segment with SYN or RST, a pure ACK, or anything
+ * after a FIN is never merged, and always ends the run before it.
+ *
+ * flush() hands over the results with each connection's segments in the order they arrived.
+ */
+class TCPSegmentCoalescer
+{
+public:
+  using DeliverFunction = std::function<void( const FourTuple&, TCPMessage )>;
+
+  static constexpr size_t DEFAULT_MAX_PAYLOAD = 64 * 1024;
+
+  //! Coalesce into segments of at most `max_payload` bytes
+  explicit TCPSegmentCoalescer( size_t max_payload = DEFAULT_MAX_PAYLOAD ) : max_payload_( max_payload ) {}
+
+  //! Add a segment of the connection named by `key` (as seen on a segment arriving from the peer)
+  void add( const FourTuple& key, TCPMessage msg );
+
+  //! Hand every pending segment to `deliver`, and start over
+  void flush( const DeliverFunction& deliver );
+
+  uint64_t segments_added() const { return segments_added_; }
+  uint64_t segments_delivered() const { return segments_delivered_; }
+
+private:
+  struct Pending
+  {
+    FourTuple key;
+    TCPMessage msg;
+    std::vector<Slice> parts {}; // payloads of the merged segments, joined on flush
+    uint64_t payload_size {};
+  };
+
+  size_t max_payload_;
+  std::vector<Pending> pending_ {}; // in order of arrival
+  FourTupleMap<size_t> growing_ {}; // index in pending_ of each connection's segment that may still grow
+
+  uint64_t segments_added_ {};
+  uint64_t segments_delivered_ {};
+
+  bool can_merge( const Pending& pending, const TCPMessage& msg ) const;
+};
@@ -5,6 +5,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <string>
 
 //! Config for TCP sender and receiver
 class TCPConfig
@@ -17,8 +19,32 @@ public:
 
   uint16_t rt_timeout = TIMEOUT_DFLT;      //!< Initial value of the retransmission timeout, in milliseconds
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
+  bool recv_autotuning = false;            //!< Grow the receive buffer with the application's read rate
+  size_t recv_capacity_max = 4 << 20;      //!< Largest receive buffer autotuning may grow to, in bytes
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
+  bool send_autotuning = false;            //!< Grow the send buffer with the bandwidth-delay product
+  size_t send_capacity_max = 4 << 20;      //!< Largest send buffer autotuning may grow to, in bytes
   Wrap32 isn { 137 };                      //!< Default initial sequence number
+  bool sack = false;                       //!< Negotiate selective acknowledgments (RFC 2018) on the SYN exchange
+  bool window_scale = false;               //!< Negotiate window scaling (RFC 7323) so windows can exceed 64 KiB
+  bool timestamps = false;                 //!< Negotiate timestamps (RFC 7323) for RTT measurement and PAWS
+  bool nagle = false;                      //!< Hold sub-MSS segments while data is in flight (Nagle's algorithm)
+  bool cork = false;                       //!< Send only full-sized segments until uncorked (or the stream ends)
+  uint16_t mss = MAX_PAYLOAD_SIZE;         //!< Largest payload to send or receive, advertised on the SYN
+  bool mtu_probing = false;                //!< Start at MAX_PAYLOAD_SIZE and probe up to the agreed MSS (RFC 4821)
+  bool pacing = false;                     //!< Spread new segments over time instead of sending whole windows
+  uint64_t pacing_rate = 0;                //!< Pacing rate in bytes/s (0 = twice the measured delivery rate)
+  bool rack_tlp = false;                   //!< Time-based loss detection and tail loss probes (RACK-TLP, RFC 8985)
+  bool ecn = false;                        //!< Negotiate ECN (RFC 3168) and back off on congestion marks
+  bool delayed_ack = false;                //!< ACK every second full-sized segment or after delayed_ack_timeout
+  uint16_t delayed_ack_timeout = 40;       //!< Longest an ACK may be delayed, in milliseconds
+  unsigned quick_acks = 16;                //!< Segments ACKed right away at the start of the connection
+  bool sws_avoidance = false;              //!< Open the receive window in big steps, announced by window updates
+  bool fast_open = false;                  //!< TCP Fast Open (RFC 7413): data on the SYN, vouched for by a cookie
+
+  //! The Fast Open cookie a server gave us, presented on our SYN if we open the connection (none: ask for one).
+  //! As a server, cookies are checked against the client's address by whoever knows it (TCPPeer::verify_fast_open).
+  std::optional<std::string> fast_open_cookie {};
 };
 
 //! Config for classes derived from FdAdapter
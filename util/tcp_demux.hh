@@ -0,0 +1,535 @@
+#pragma once
+
+#include "address.hh"
+#include "four_tuple.hh"
+#include "ipv4_datagram.hh"
+#include "random.hh"
+#include "tcp_coalescer.hh"
+#include "tcp_config.hh"
+#include "tcp_fast_open.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_peer.hh"
+#include "timer_wheel.hh"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+ * Terminates many TCP connections over one IPv4 datagram interface, such as a single TUN device.
+ *
+ * Each arriving datagram is parsed once, and its TCP segment goes to the TCPPeer of the connection named
+ * by its (source address, source port, destination address, destination port). A SYN to a listening port
+ * that matches no connection starts a new one. Every TCPPeer writes its segments through the same
+ * DatagramWriter, as the IPv4 and TCP headers followed by the uncopied payload.
+ *
+ * A port can also listen with a backlog, like a listening socket: connections wait in an accept queue
+ * once their handshake completes, until the application takes them with accept(). While `backlog`
+ * connections are half-open, further SYNs are answered with SYN cookies, keeping no state until the
+ * final ACK of the handshake proves the peer received our SYN-ACK.
+ *
+ * With TCP Fast Open in the config, connections to a listening port are issued cookies for the client's
+ * address (a keyed hash of it), and take data on a SYN only with the cookie for the address the SYN comes from.
+ * Connections opened by connect() keep the cookies they are given in a cache by server address.
+ * A connection to a server we hold a cookie for sends its SYN at the first push() instead of at once, so that
+ * the SYN carries the data written by then (like TCP_FASTOPEN_CONNECT).
+ *
+ * Each connection's next timeout (see TCPPeer::next_timeout_ms) is kept on a timer wheel, so tick() visits
+ * only the connections whose timers come due. The others catch up on the time that has passed the next
+ * time a segment arrives for them or they are pushed.
+ */
+class TCPOverIPv4Demultiplexer
+{
+public:
+  //! Writes one IPv4 datagram, given as the buffers to gather (e.g. FileDescriptor::write on a TUN device)
+  using DatagramWriter = std::function<void( const std::vector<std::string_view>& )>;
+
+  //! Called when a SYN to a listening port starts a new connection (after the TCPPeer has received the SYN)
+  using AcceptFunction = std::function<void( const FourTuple&, TCPPeer& )>;
+
+  //! New connections use `cfg`, each with its own random initial sequence number
+  TCPOverIPv4Demultiplexer( const TCPConfig& cfg, DatagramWriter writer )
+    : cfg_( cfg ), writer_( std::move( writer ) )
+  {}
+
+  // Each connection transmits through a pointer to its demultiplexer, so the demultiplexer must not move
+  TCPOverIPv4Demultiplexer( const TCPOverIPv4Demultiplexer& other ) = delete;
+  TCPOverIPv4Demultiplexer& operator=( const TCPOverIPv4Demultiplexer& other ) = delete;
+  TCPOverIPv4Demultiplexer( TCPOverIPv4Demultiplexer&& other ) = delete;
+  TCPOverIPv4Demultiplexer& operator=( TCPOverIPv4Demultiplexer&& other ) = delete;
+
+  //! Accept connections to `port` on any local address
+  void listen( uint16_t port, AcceptFunction on_accept = {} )
+  {
+    listeners_.push_back( { port, std::move( on_accept ) } );
+  }
+
+  //! Accept connections to `port` on any local address into an accept queue of up to `backlog` connections
+  void listen( uint16_t port, size_t backlog )
+  {
+    if ( backlog == 0 ) {
+      throw std::runtime_error( "listen backlog must be at least one connection" );
+    }
+    listeners_.push_back( { port, {}, backlog } );
+  }
+
+  //! Take the next connection to `port` that has completed its handshake (if any) from the accept queue
+  std::optional<FourTuple> accept( uint16_t port )
+  {
+    Listener* listener = find_listener( port );
+    if ( listener == nullptr ) {
+      return {};
+    }
+    while ( not listener->accept_queue.empty() ) {
+      const FourTuple addresses = listener->accept_queue.front();
+      listener->accept_queue.pop_front();
+      if ( find( addresses ) != nullptr ) { // a connection reset before it was accepted is skipped
+        return addresses;
+      }
+    }
+    return {};
+  }
+
+  //! Open a connection from `local` to `remote` (sends the SYN, unless it waits to carry data with Fast Open: then
+  //! it goes out on push(), or alone on the first tick after time has passed)
+  TCPPeer& connect( const Address& local, const Address& remote )
+  {
+    const FourTuple addresses { remote.ipv4_numeric(), remote.port(), local.ipv4_numeric(), local.port() };
+    std::optional<std::string> cookie;
+    if ( cfg_.fast_open ) {
+      cookie = fast_open_cache_.find( remote.ipv4_numeric() );
+    }
+    Connection* connection = add_connection( addresses, {}, cookie );
+    if ( connection == nullptr ) {
+      throw std::runtime_error( "connection already exists: " + local.to_string() + " -> " + remote.to_string() );
+    }
+    if ( not cookie.has_value() ) {
+      connection->peer.push( connection->transmit );
+    }
+    reschedule( *connection );
+    return connection->peer;
+  }
+
+  //! Hand a datagram read from the interface to the connection it belongs to
+  void receive( InternetDatagram ip_dgram )
+  {
+    if ( auto segment = parse_segment( std::move( ip_dgram ) ) ) {
+      receive( segment->first, std::move( segment->second ) );
+    }
+  }
+
+  //! Hand over the datagrams read from the interface in one wakeup. Back-to-back in-order segments of a
+  //! connection are coalesced first (see TCPSegmentCoalescer), so its TCPPeer handles the run once.
+  void receive( std::vector<InternetDatagram> datagrams )
+  {
+    for ( auto& ip_dgram : datagrams ) {
+      if ( auto segment = parse_segment( std::move( ip_dgram ) ) ) {
+        coalescer_.add( segment->first, std::move( segment->second ) );
+      }
+    }
+    coalescer_.flush( [this]( const FourTuple& key, TCPMessage msg ) { receive( key, std::move( msg ) ); } );
+  }
+
+  //! Same, for segments already parsed from their datagrams
+  void receive( std::vector<std::pair<FourTuple, TCPMessage>> segments )
+  {
+    for ( auto& [key, msg] : segments ) {
+      coalescer_.add( key, std::move( msg ) );
+    }
+    coalescer_.flush( [this]( const FourTuple& key, TCPMessage msg ) { receive( key, std::move( msg ) ); } );
+  }
+
+  //! Hand a segment, already parsed from its datagram, to the connection named by `key`
+  void receive( const FourTuple& key, TCPMessage msg )
+  {
+    Connection* connection = nullptr;
+    if ( const uint32_t* index = table_.find( key ) ) {
+      connection = connections_[*index].get();
+    } else if ( Listener* listener = find_listener( key.dst_port ) ) {
+      connection = open_passive( *listener, key, msg );
+    } else {
+      unmatched_segments_++;
+    }
+    if ( connection == nullptr ) {
+      return;
+    }
+
+    const bool syn = msg.sender->SYN;
+    catch_up( *connection );
+    connection->peer.receive( std::move( msg ), connection->transmit );
+    if ( syn and cfg_.fast_open ) {
+      if ( auto cookie = connection->peer.fast_open_cookie() ) {
+        fast_open_cache_.store( key.src_ip, *cookie );
+      }
+    }
+    if ( connection->accepted ) {
+      connection->accepted = false;
+      connection->on_accept( key, connection->peer );
+    }
+    if ( connection->half_open_in != nullptr and connection->peer.established() ) {
+      connection->half_open_in->half_open--;
+      connection->half_open_in->accept_queue.push_back( key );
+      connection->half_open_in = nullptr;
+    }
+    reschedule( *connection );
+  }
+
+  //! The TCP segment carried by a datagram, with the four-tuple of the connection it belongs to
+  static std::optional<std::pair<FourTuple, TCPMessage>> parse_segment( InternetDatagram ip_dgram )
+  {
+    std::optional<TCPSegment> segment = TCPOverIPv4Adapter::parse_tcp_in_ip( ip_dgram );
+    if ( not segment.has_value() ) {
+      return {};
+    }
+    return std::pair {
+      FourTuple { ip_dgram.header.src, segment->udinfo.src_port, ip_dgram.header.dst, segment->udinfo.dst_port },
+      std::move( segment->message ) };
+  }
+
+  //! Send what the application has written to a connection's outbound stream
+  void push( const FourTuple& addresses )
+  {
+    if ( const uint32_t* index = table_.find( addresses ) ) {
+      Connection& connection = *connections_[*index];
+      catch_up( connection );
+      connection.peer.push( connection.transmit );
+      reschedule( connection );
+    }
+  }
+
+  //! Time has passed: tick the connections whose timers have come due, and forget the ones that have finished
+  void tick( uint64_t ms_since_last_tick )
+  {
+    time_ms_ += ms_since_last_tick;
+    timers_.advance( ms_since_last_tick, [this]( uint32_t index ) { due_.push_back( index ); } );
+    for ( const uint32_t index : due_ ) {
+      Connection& connection = *connections_[index];
+      timer_expirations_++;
+      catch_up( connection );
+      if ( connection.peer.active() ) {
+        reschedule( connection );
+        continue;
+      }
+      if ( connection.half_open_in != nullptr ) {
+        connection.half_open_in->half_open--;
+      }
+      table_.erase( connection.addresses );
+      connections_[index].reset();
+      free_slots_.push_back( index );
+    }
+    due_.clear();
+  }
+
+  //! The connection named by the addresses and ports on a segment arriving from its peer (nullptr if none)
+  TCPPeer* find( const FourTuple& addresses )
+  {
+    const uint32_t* index = table_.find( addresses );
+    return index ? &connections_[*index]->peer : nullptr;
+  }
+
+  size_t connection_count() const { return table_.size(); }
+
+  //! Segments received in batches, before and after coalescing
+  const TCPSegmentCoalescer& coalescer() const { return coalescer_; }
+
+  //! Segments that belonged to no connection (and weren't a SYN to a listening port, or a valid SYN cookie)
+  uint64_t unmatched_segments() const { return unmatched_segments_; }
+
+  //! SYN-ACKs sent with a SYN cookie, instead of starting a half-open connection
+  uint64_t syn_cookies_sent() const { return syn_cookies_sent_; }
+
+  //! Connections started by the final ACK of a handshake that carried a valid SYN cookie
+  uint64_t syn_cookies_accepted() const { return syn_cookies_accepted_; }
+
+  //! Handshakes dropped because the listener's accept queue was full
+  uint64_t listen_overflows() const { return listen_overflows_; }
+
+  //! Fast Open cookies given to us by servers (connect() presents them, and a server may be forgotten)
+  TCPFastOpenCache& fast_open_cache() { return fast_open_cache_; }
+
+  //! Connections ticked because one of their timers came due
+  uint64_t timer_expirations() const { return timer_expirations_; }
+
+private:
+  struct Listener
+  {
+    uint16_t port;
+    AcceptFunction on_accept {};
+    size_t backlog {}; // zero: no accept queue or SYN cookies
+    size_t half_open {};
+    std::deque<FourTuple> accept_queue {};
+  };
+
+  struct Connection
+  {
+    FourTuple addresses;
+    TCPPeer peer;
+    TCPPeer::TransmitFunction transmit {};
+    AcceptFunction on_accept {};
+    bool accepted {};          // the peer is about to receive the SYN that started the connection
+    Listener* half_open_in {}; // the listener whose accept queue it joins once established
+    uint32_t index {};         // slot in connections_
+
+    // The demultiplexer's time when the peer was last ticked, and its next timeout on the timer wheel
+    uint64_t ticked_ms {};
+    TimerWheel<uint32_t>::TimerId timer {};
+    uint64_t deadline_ms {};
+  };
+
+  TCPConfig cfg_;
+  DatagramWriter writer_;
+  std::default_random_engine rd_ { get_random_engine() };
+  std::deque<Listener> listeners_ {}; // connections point to their listener, so it must not move
+
+  // Connections live at stable addresses; the table maps each four-tuple to a slot here. Its hash is seeded
+  // with a secret, as the SYN cookies are, so a peer can't pick four-tuples that pile into one probe run.
+  std::vector<std::unique_ptr<Connection>> connections_ {};
+  std::vector<uint32_t> free_slots_ {};
+  FourTupleMap<uint32_t> table_ { ( static_cast<uint64_t>( rd_() ) << 32 ) | rd_() };
+
+  TCPSegmentCoalescer coalescer_ {};
+
+  TimerWheel<uint32_t> timers_ {}; // the slot of each connection with a timer running, by its next timeout
+  std::vector<uint32_t> due_ {};
+
+  uint64_t unmatched_segments_ {};
+  uint64_t syn_cookies_sent_ {};
+  uint64_t syn_cookies_accepted_ {};
+  uint64_t listen_overflows_ {};
+  uint64_t timer_expirations_ {};
+
+  // SYN cookies: a secret, and the clock whose 64-second periods a cookie's age is counted in
+  static constexpr uint64_t COOKIE_PERIOD_MS = 64 * 1000;
+  static constexpr std::array<uint16_t, 8> COOKIE_MSS { 0, 536, 1000, 1220, 1400, 1440, 1460, 8960 }; // 0: none
+  uint64_t cookie_secret_ { ( static_cast<uint64_t>( rd_() ) << 32 ) | rd_() };
+  uint64_t time_ms_ {};
+
+  // TCP Fast Open: the cookies we issue as a server, and the ones we hold as a client
+  TCPFastOpenCookies fast_open_cookies_ { ( static_cast<uint64_t>( rd_() ) << 32 ) | rd_() };
+  TCPFastOpenCache fast_open_cache_ {};
+
+  Listener* find_listener( uint16_t port )
+  {
+    for ( auto& listener : listeners_ ) {
+      if ( listener.port == port ) {
+        return &listener;
+      }
+    }
+    return nullptr;
+  }
+
+  // Start a connection to a listening port, for a SYN (without ACK or RST) or for the final ACK of a
+  // handshake answered with a SYN cookie. Returns nullptr if the segment starts no connection.
+  Connection* open_passive( Listener& listener, const FourTuple& addresses, const TCPMessage& msg )
+  {
+    if ( msg.sender->RST ) {
+      unmatched_segments_++;
+      return nullptr;
+    }
+    if ( not msg.sender->SYN ) {
+      return open_from_cookie( listener, addresses, msg );
+    }
+    if ( msg.receiver->ackno.has_value() ) {
+      unmatched_segments_++;
+      return nullptr;
+    }
+
+    if ( listener.backlog > 0 ) {
+      if ( listener.accept_queue.size() >= listener.backlog ) {
+        listen_overflows_++;
+        return nullptr;
+      }
+      if ( listener.half_open >= listener.backlog ) {
+        send_syn_cookie( addresses, msg );
+        return nullptr;
+      }
+    }
+
+    Connection* connection = add_connection( addresses );
+    if ( cfg_.fast_open ) {
+      // the cookie on the SYN must be the one made for the address it comes from
+      const auto& cookie = msg.receiver->fast_open_cookie;
+      const bool valid = cookie.has_value() and fast_open_cookies_.valid( addresses.src_ip, *cookie );
+      connection->peer.verify_fast_open( valid, fast_open_cookies_.make( addresses.src_ip ) );
+    }
+    if ( listener.on_accept ) {
+      connection->on_accept = listener.on_accept;
+      connection->accepted = true;
+    }
+    if ( listener.backlog > 0 ) {
+      listener.half_open++;
+      connection->half_open_in = &listener;
+    }
+    return connection;
+  }
+
+  // The SYN cookie, our initial sequence number for a SYN from `addresses`: the period it was made in
+  // (5 bits), the MSS the peer offered, rounded down to one of eight sizes (3 bits), and 24 bits of a keyed
+  // hash of these, the addresses and the peer's initial sequence number.
+  uint32_t syn_cookie( const FourTuple& addresses, Wrap32 peer_isn, uint64_t period, uint32_t mss_index ) const
+  {
+    uint64_t h = addresses.hash() ^ cookie_secret_;
+    h ^= ( static_cast<uint64_t>( raw( peer_isn ) ) << 32 | ( period << 3 | mss_index ) ) * 0x9e3779b97f4a7c15;
+    h = ( h ^ ( h >> 30 ) ) * 0xbf58476d1ce4e5b9;
+    h = ( h ^ ( h >> 27 ) ) * 0x94d049bb133111eb;
+    h ^= h >> 31;
+    return static_cast<uint32_t>( ( period % 32 ) << 27 | mss_index << 24 | ( h & 0xffffff ) );
+  }
+
+  static uint32_t raw( Wrap32 seqno ) { return static_cast<uint32_t>( seqno.unwrap( Wrap32 { 0 }, 0 ) ); }
+
+  // Answer a SYN with a SYN-ACK whose sequence number is a SYN cookie, and keep nothing. The SYN-ACK offers
+  // no options except the MSS, since there's nowhere to remember what the peer offered.
+  void send_syn_cookie( const FourTuple& addresses, const TCPMessage& syn )
+  {
+    uint32_t mss_index = 0;
+    if ( syn.receiver->mss.has_value() ) {
+      mss_index = 1;
+      while ( mss_index + 1 < COOKIE_MSS.size() and COOKIE_MSS[mss_index + 1] <= *syn.receiver->mss ) {
+        mss_index++;
+      }
+    }
+
+    TCPSenderMessage syn_ack;
+    syn_ack.seqno = Wrap32 { syn_cookie( addresses, syn.sender->seqno, time_ms_ / COOKIE_PERIOD_MS, mss_index ) };
+    syn_ack.SYN = true;
+    TCPReceiverMessage ack;
+    ack.ackno = syn.sender->seqno + 1;
+    ack.window_size = static_cast<uint16_t>( std::min<uint64_t>( cfg_.recv_capacity, UINT16_MAX ) );
+    ack.mss = cfg_.mss;
+    write( { std::move( syn_ack ), std::move( ack ) }, addresses.reversed() );
+    syn_cookies_sent_++;
+  }
+
+  // Start a connection for an ACK that acknowledges a SYN cookie made within the last two periods. The new
+  // TCPPeer takes the cookie as its initial sequence number and is handed the SYN that the cookie stands for,
+  // so it is ready for the ACK (its SYN-ACK is not sent again).
+  Connection* open_from_cookie( Listener& listener, const FourTuple& addresses, const TCPMessage& msg )
+  {
+    if ( listener.backlog == 0 or not msg.receiver->ackno.has_value() ) {
+      unmatched_segments_++;
+      return nullptr;
+    }
+
+    const Wrap32 peer_isn = msg.sender->seqno + UINT32_MAX; // one before the first sequence number after the SYN
+    const uint32_t cookie = raw( *msg.receiver->ackno + UINT32_MAX );
+    const uint32_t mss_index = ( cookie >> 24 ) & 0x7;
+    const uint64_t now = time_ms_ / COOKIE_PERIOD_MS;
+    bool valid = false;
+    for ( uint64_t age = 0; age < 2 and age <= now and not valid; age++ ) {
+      valid = syn_cookie( addresses, peer_isn, now - age, mss_index ) == cookie;
+    }
+    if ( not valid ) {
+      unmatched_segments_++;
+      return nullptr;
+    }
+    if ( listener.accept_queue.size() >= listener.backlog ) {
+      listen_overflows_++;
+      return nullptr;
+    }
+
+    Connection* connection = add_connection( addresses, Wrap32 { cookie } );
+    if ( connection == nullptr ) {
+      return nullptr;
+    }
+    TCPSenderMessage syn;
+    syn.seqno = peer_isn;
+    syn.SYN = true;
+    TCPReceiverMessage syn_options;
+    syn_options.window_size = msg.receiver->window_size;
+    if ( mss_index > 0 ) {
+      syn_options.mss = COOKIE_MSS[mss_index];
+    }
+    const auto discard = []( std::span<const TCPMessage> /*batch*/ ) {};
+    connection->peer.receive( { std::move( syn ), std::move( syn_options ) }, discard );
+
+    connection->half_open_in = &listener;
+    listener.half_open++;
+    syn_cookies_accepted_++;
+    return connection;
+  }
+
+  // A new connection with the given addresses (nullptr if it already exists), with a random initial sequence
+  // number unless one is given, and the Fast Open cookie to present to the server (if any)
+  Connection* add_connection( const FourTuple& addresses,
+                              std::optional<Wrap32> isn = {},
+                              std::optional<std::string> fast_open_cookie = {} )
+  {
+    uint32_t index {};
+    if ( free_slots_.empty() ) {
+      index = connections_.size();
+      connections_.emplace_back();
+    } else {
+      index = free_slots_.back();
+      free_slots_.pop_back();
+    }
+
+    if ( not table_.insert( addresses, index ).second ) {
+      free_slots_.push_back( index );
+      return nullptr;
+    }
+
+    TCPConfig cfg = cfg_;
+    cfg.isn = isn.value_or( Wrap32 { static_cast<uint32_t>( rd_() ) } );
+    cfg.fast_open_cookie = std::move( fast_open_cookie );
+    connections_[index] = std::make_unique<Connection>( Connection { addresses, TCPPeer { cfg } } );
+
+    Connection* connection = connections_[index].get();
+    connection->index = index;
+    connection->ticked_ms = time_ms_;
+    connection->transmit = [this, outbound = addresses.reversed()]( std::span<const TCPMessage> batch ) {
+      for ( const auto& msg : batch ) {
+        write( msg, outbound );
+      }
+    };
+    return connection;
+  }
+
+  // Tick a connection for the time that has passed since it was last ticked
+  void catch_up( Connection& connection )
+  {
+    if ( time_ms_ > connection.ticked_ms ) {
+      connection.peer.tick( time_ms_ - connection.ticked_ms, connection.transmit );
+      connection.ticked_ms = time_ms_;
+    }
+  }
+
+  // Put a connection's next timeout on the timer wheel (or take it off, if no timer runs)
+  void reschedule( Connection& connection )
+  {
+    const std::optional<uint64_t> timeout = connection.peer.next_timeout_ms();
+    if ( timeout.has_value() and timers_.pending( connection.timer )
+         and connection.deadline_ms == time_ms_ + *timeout ) {
+      return;
+    }
+    timers_.cancel( connection.timer );
+    if ( timeout.has_value() ) {
+      connection.deadline_ms = time_ms_ + *timeout;
+      connection.timer = timers_.schedule( connection.deadline_ms, connection.index );
+    }
+  }
+
+  void write( const TCPMessage& msg, const FourTuple& outbound ) const
+  {
+    const std::vector<Ref<std::string>> headers = TCPOverIPv4Adapter::wrap_tcp_headers( msg, outbound );
+    std::vector<std::string_view> buffers;
+    buffers.reserve( headers.size() + 1 );
+    for ( const auto& header : headers ) {
+      buffers.emplace_back( header.get() );
+    }
+    if ( not msg.sender->payload.empty() ) {
+      buffers.push_back( msg.sender->payload );
+    }
+    writer_( buffers );
+  }
+};
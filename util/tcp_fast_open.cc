@@ -0,0 +1,57 @@
+#include "tcp_fast_open.hh"
+
+using namespace std;
+
+string TCPFastOpenCookies::make( uint32_t client_ip ) const
+{
+  // the finalizer of SplitMix64, over the address keyed with the secret
+  uint64_t h = ( secret_ ^ client_ip ) * 0x9e3779b97f4a7c15;
+  h = ( h ^ ( h >> 30 ) ) * 0xbf58476d1ce4e5b9;
+  h = ( h ^ ( h >> 27 ) ) * 0x94d049bb133111eb;
+  h ^= h >> 31;
+
+  string cookie( COOKIE_LENGTH, 0 );
+  for ( size_t i = 0; i < COOKIE_LENGTH; i++ ) {
+    cookie[i] = static_cast<char>( h >> ( 8 * i ) );
+  }
+  return cookie;
+}
+
+bool TCPFastOpenCookies::valid( uint32_t client_ip, string_view cookie ) const
+{
+  return cookie == make( client_ip );
+}
+
+optional<string> TCPFastOpenCache::find( uint32_t server_ip ) const
+{
+  const lock_guard lock { mutex_ };
+  const auto it = cookies_.find( server_ip );
+  if ( it == cookies_.end() ) {
+    return {};
+  }
+  return it->second;
+}
+
+void TCPFastOpenCache::store( uint32_t server_ip, const string& cookie )
+{
+  const lock_guard lock { mutex_ };
+  cookies_[server_ip] = cookie;
+}
+
+void TCPFastOpenCache::erase( uint32_t server_ip )
+{
+  const lock_guard lock { mutex_ };
+  cookies_.erase( server_ip );
+}
+
+size_t TCPFastOpenCache::size() const
+{
+  const lock_guard lock { mutex_ };
+  return cookies_.size();
+}
+
+TCPFastOpenCache& TCPFastOpenCache::shared()
+{
+  static TCPFastOpenCache cache;
+  return cache;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+ * TCP Fast Open (RFC 7413) lets a client send data on its SYN, saving the round trip of the handshake on
+ * short connections. The server vouches for a client's address by handing it a cookie (on the SYN-ACK of an
+ * ordinary handshake where the client asked for one); on later connections, the client presents the cookie
+ * on a SYN that carries data, and the server takes the data at once if the cookie is right for the address
+ * the SYN came from. Without a valid cookie, the server acknowledges only the SYN, and the client sends the
+ * data again after the handshake.
+ */
+
+//! The server's side: makes the cookie for a client's address, a keyed hash that only the server can compute
+class TCPFastOpenCookies
+{
+public:
+  static constexpr size_t COOKIE_LENGTH = 8;
+
+  explicit TCPFastOpenCookies( uint64_t secret ) : secret_( secret ) {}
+
+  std::string make( uint32_t client_ip ) const;
+
+  //! Is `cookie` the one made for `client_ip`? A cookie learned by one client is no good from another address.
+  bool valid( uint32_t client_ip, std::string_view cookie ) const;
+
+private:
+  uint64_t secret_;
+};
+
+//! The client's side: the cookie each server has given us, by server address. Safe to share between threads.
+class TCPFastOpenCache
+{
+public:
+  std::optional<std::string> find( uint32_t server_ip ) const;
+  void store( uint32_t server_ip, const std::string& cookie );
+  void erase( uint32_t server_ip );
+  size_t size() const;
+
+  //! The cache shared by every connection in the process (as the kernel keeps one per host)
+  static TCPFastOpenCache& shared();
+
+private:
+  mutable std::mutex mutex_ {};
+  std::unordered_map<uint32_t, std::string> cookies_ {};
+};
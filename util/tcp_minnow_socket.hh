@@ -4,11 +4,14 @@
 #include "file_descriptor.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
+#include "tcp_fast_open.hh"
 #include "tcp_peer.hh"
+#include "tcp_stats.hh"
 #include "tuntap_adapter.hh"
 
 #include <atomic>
 #include <cstdint>
+#include <mutex>
 #include <optional>
 #include <thread>
 
@@ -25,7 +28,9 @@ public:
   //! or else may wait foreever for remote peer to close the TCP connection.
   void wait_until_closed();
 
-  //! Connect using the specified configurations; blocks until connect succeeds or fails
+  //! Connect using the specified configurations; blocks until connect succeeds or fails (with TCP Fast Open and a
+  //! cookie for the destination, returns at once, and the SYN carries the first data written, or goes out alone
+  //! if nothing is written within a tick; a failed handshake then shows as an error on the inbound stream)
   void connect( const TCPConfig& c_tcp, const FdAdapterConfig& c_ad );
 
   //! Listen and accept using the specified configurations; blocks until accept succeeds or fails
@@ -53,6 +58,15 @@ public:
   void set_reuseaddr() = delete;
   //!@}
 
+  //! Disable (or re-enable) Nagle's algorithm, like TCP_NODELAY
+  void set_nodelay( bool nodelay );
+
+  //! Hold back partial segments until uncorked, like TCP_CORK
+  void set_cork( bool corked );
+
+  //! Transport statistics for the connection, published by the TCPPeer thread once per tick (every 10 ms)
+  TCPStats stats() const;
+
   // Return peer address from underlying datagram adapter
   const Address& peer_address() const { return _datagram_adapter.config().destination; }
 
@@ -92,6 +106,38 @@ private:
   bool _outbound_shutdown { false }; //!< Has the owner shut down the outbound data to the TCP connection?
 
   bool _fully_acked { false }; //!< Has the outbound data been fully acknowledged by the peer?
+
+  //! \name
+  //! Segment-coalescing options requested by the owner, applied by the TCPPeer thread
+
+  //!@{
+  std::atomic_bool _nagle { false };
+  std::atomic_bool _cork { false };
+  std::atomic_bool _coalescing_changed { false };
+  //!@}
+
+  //! Apply any segment-coalescing options the owner has changed since the last call
+  void _apply_coalescing_options();
+
+  //! \name
+  //! Snapshot of the TCPPeer's statistics, published by the TCPPeer thread for the owner to read
+
+  //!@{
+  mutable std::mutex _stats_mutex {};
+  TCPStats _stats {};
+  //!@}
+
+  //! Copy the TCPPeer's statistics into the snapshot
+  void _publish_stats();
+
+  //! Has connect() left the handshake, with its Fast Open SYN, to the TCPPeer thread?
+  bool _fast_open_connecting { false };
+
+  //! Report how the handshake ended, and keep any Fast Open cookie the peer issued
+  void _finish_connect();
+
+  //! Keep the Fast Open cookie the peer issued (if any) for the next connection to it
+  void _remember_fast_open_cookie();
 };
 
 using TCPOverIPv4MinnowSocket = TCPMinnowSocket<TCPOverIPv4OverTunFdAdapter>;
@@ -122,10 +168,15 @@ class CS144TCPSocket : public TCPOverIPv4MinnowSocket
 {
 public:
   CS144TCPSocket() : TCPOverIPv4MinnowSocket( TCPOverIPv4OverTunFdAdapter { TunFD { "tun144" } } ) {}
+
+  //! Use TCP Fast Open: ask the server for a cookie, and send the request on the SYN once we hold one
+  void set_fast_open( bool enabled ) { fast_open_ = enabled; }
+
   void connect( const Address& address )
   {
     TCPConfig tcp_config;
     tcp_config.rt_timeout = 100;
+    tcp_config.fast_open = fast_open_;
 
     FdAdapterConfig multiplexer_config;
     multiplexer_config.source
@@ -134,4 +185,7 @@ public:
 
     TCPOverIPv4MinnowSocket::connect( tcp_config, multiplexer_config );
   }
+
+private:
+  bool fast_open_ {};
 };
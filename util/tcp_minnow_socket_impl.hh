@@ -24,6 +24,7 @@ template<TCPDatagramAdapter AdaptT>
 void TCPMinnowSocket<AdaptT>::_tcp_loop( const std::function<bool()>& condition )
 {
   auto base_time = timestamp_ms();
+  auto published_time = base_time;
   while ( condition() ) {
     auto ret = _eventloop.wait_next_event( TCP_TICK_MS );
     if ( ret == EventLoop::Result::Exit or _abort ) {
@@ -34,13 +35,88 @@ void TCPMinnowSocket<AdaptT>::_tcp_loop( const std::function<bool()>& condition
       throw std::runtime_error( "_tcp_loop entered before TCPPeer initialized" );
     }
 
+    _apply_coalescing_options();
+
     if ( _tcp.value().active() ) {
       const auto next_time = timestamp_ms();
-      _tcp.value().tick( next_time - base_time, [&]( auto x ) { _datagram_adapter.write( x ); } );
+      _tcp.value().tick( next_time - base_time, [&]( auto batch ) { _datagram_adapter.write_batch( batch ); } );
       _datagram_adapter.tick( next_time - base_time );
       base_time = next_time;
     }
+
+    // Building the statistics walks the reassembler, so publish them once per tick, not after every event
+    if ( base_time - published_time >= TCP_TICK_MS ) {
+      _publish_stats();
+      published_time = base_time;
+    }
+  }
+
+  if ( _tcp.has_value() ) {
+    _publish_stats();
+  }
+}
+
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_finish_connect()
+{
+  const std::string destination = _datagram_adapter.config().destination.to_string();
+  if ( _tcp->inbound_reader().has_error() ) {
+    std::cerr << "DEBUG: minnow error on connecting to " << destination << ".\n";
+  } else {
+    std::cerr << "DEBUG: minnow successfully connected to " << destination << ".\n";
+  }
+  _remember_fast_open_cookie();
+}
+
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_remember_fast_open_cookie()
+{
+  if ( auto cookie = _tcp->fast_open_cookie() ) {
+    TCPFastOpenCache::shared().store( _datagram_adapter.config().destination.ipv4_numeric(), *cookie );
+  }
+}
+
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_publish_stats()
+{
+  const TCPStats stats = _tcp->stats();
+  const std::lock_guard lock { _stats_mutex };
+  _stats = stats;
+}
+
+template<TCPDatagramAdapter AdaptT>
+TCPStats TCPMinnowSocket<AdaptT>::stats() const
+{
+  const std::lock_guard lock { _stats_mutex };
+  return _stats;
+}
+
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_apply_coalescing_options()
+{
+  if ( not _coalescing_changed.exchange( false ) ) {
+    return;
   }
+
+  _tcp->set_nagle( _nagle );
+  _tcp->set_cork( _cork );
+  _tcp->push( [&]( auto batch ) { _datagram_adapter.write_batch( batch ); } );
+}
+
+//! \param[in] nodelay is true to send partial segments immediately
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::set_nodelay( bool nodelay )
+{
+  _nagle = not nodelay;
+  _coalescing_changed = true;
+}
+
+//! \param[in] corked is true to hold back partial segments, false to release them
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::set_cork( bool corked )
+{
+  _cork = corked;
+  _coalescing_changed = true;
 }
 
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
@@ -61,6 +137,12 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
 {
   _tcp.emplace( config );
 
+  // Options set by the owner before connecting take precedence over the config
+  if ( not _coalescing_changed ) {
+    _nagle = config.nagle;
+    _cork = config.cork;
+  }
+
   // Set up the event loop
 
   // There are three events to handle:
@@ -82,7 +164,7 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     Direction::In,
     [&] {
       if ( auto seg = _datagram_adapter.read() ) {
-        _tcp->receive( std::move( seg.value() ), [&]( auto x ) { _datagram_adapter.write( x ); } );
+        _tcp->receive( std::move( seg.value() ), [&]( auto batch ) { _datagram_adapter.write_batch( batch ); } );
       }
 
       // debugging output:
@@ -116,7 +198,7 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
                   << " still in flight).\n";
       }
 
-      _tcp->push( [&]( auto x ) { _datagram_adapter.write( x ); } );
+      _tcp->push( [&]( auto batch ) { _datagram_adapter.write_batch( batch ); } );
     },
     [&] {
       return ( _tcp->active() ) and ( not _outbound_shutdown )
@@ -209,6 +291,7 @@ void TCPMinnowSocket<AdaptT>::wait_until_closed()
     std::cerr << "DEBUG: minnow waiting for clean shutdown... ";
     _tcp_thread.join();
     std::cerr << "done.\n";
+    std::cerr << "DEBUG: minnow connection statistics: " << stats().to_string() << "\n";
   }
 }
 
@@ -221,7 +304,13 @@ void TCPMinnowSocket<AdaptT>::connect( const TCPConfig& c_tcp, const FdAdapterCo
     throw std::runtime_error( "connect() with TCPConnection already initialized" );
   }
 
-  _initialize_TCP( c_tcp );
+  // TCP Fast Open: present the cookie this host gave an earlier connection, if any
+  TCPConfig tcp_config = c_tcp;
+  if ( tcp_config.fast_open and not tcp_config.fast_open_cookie.has_value() ) {
+    tcp_config.fast_open_cookie = TCPFastOpenCache::shared().find( c_ad.destination.ipv4_numeric() );
+  }
+
+  _initialize_TCP( tcp_config );
 
   _datagram_adapter.config_mut() = c_ad;
 
@@ -231,18 +320,24 @@ void TCPMinnowSocket<AdaptT>::connect( const TCPConfig& c_tcp, const FdAdapterCo
     throw std::runtime_error( "TCPPeer not successfully initialized" );
   }
 
-  _tcp->push( [&]( auto x ) { _datagram_adapter.write( x ); } );
+  // With a cookie, don't wait for the handshake: the SYN goes out with the first data written to the socket
+  // (like TCP_FASTOPEN_CONNECT), saving a round trip, or alone at the next tick if the application only reads.
+  // The TCPPeer thread finishes the handshake.
+  if ( tcp_config.fast_open and tcp_config.fast_open_cookie.has_value() ) {
+    std::cerr << "DEBUG: minnow using TCP Fast Open to " << c_ad.destination.to_string() << ".\n";
+    _fast_open_connecting = true;
+    _tcp_thread = std::thread( &TCPMinnowSocket::_tcp_main, this );
+    return;
+  }
+
+  _tcp->push( [&]( auto batch ) { _datagram_adapter.write_batch( batch ); } );
 
   if ( _tcp->sender().sequence_numbers_in_flight() != 1 ) {
     throw std::runtime_error( "After TCPConnection::connect(), expected sequence_numbers_in_flight() == 1" );
   }
 
   _tcp_loop( [&] { return _tcp->sender().sequence_numbers_in_flight() == 1; } );
-  if ( _tcp->inbound_reader().has_error() ) {
-    std::cerr << "DEBUG: minnow error on connecting to " << c_ad.destination.to_string() << ".\n";
-  } else {
-    std::cerr << "DEBUG: minnow successfully connected to " << c_ad.destination.to_string() << ".\n";
-  }
+  _finish_connect();
 
   _tcp_thread = std::thread( &TCPMinnowSocket::_tcp_main, this );
 }
@@ -275,6 +370,11 @@ void TCPMinnowSocket<AdaptT>::_tcp_main()
     if ( not _tcp.has_value() ) {
       throw std::runtime_error( "no TCP" );
     }
+    if ( _fast_open_connecting ) {
+      // A failed handshake (a RST, or the SYN given up on) leaves its error on the inbound stream, as in connect()
+      _tcp_loop( [&] { return _tcp->active() and not _tcp->established(); } );
+      _finish_connect();
+    }
     _tcp_loop( [] { return true; } );
     shutdown( SHUT_RDWR );
     if ( not _tcp.value().active() ) {
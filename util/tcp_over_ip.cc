@@ -35,16 +35,12 @@ optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( InternetDatagram ip_d
     return {};
   }
 
-  // does the IPv4 datagram claim that its payload is a TCP segment?
-  if ( ip_dgram.header.proto != IPv4Header::PROTO_TCP ) {
-    return {};
-  }
-
   // is the payload a valid TCP segment?
-  TCPSegment tcp_seg;
-  if ( not parse( tcp_seg, move( ip_dgram.payload ), ip_dgram.header.pseudo_checksum() ) ) {
+  optional<TCPSegment> parsed = parse_tcp_in_ip( ip_dgram );
+  if ( not parsed.has_value() ) {
     return {};
   }
+  TCPSegment& tcp_seg = *parsed;
 
   // is the TCP segment for us?
   if ( tcp_seg.udinfo.dst_port != config().source.port() ) {
@@ -71,26 +67,89 @@ optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( InternetDatagram ip_d
   return move( tcp_seg.message );
 }
 
+//! Parses the TCP segment in a datagram's payload, whatever its addresses and ports
+//! \returns the segment, or nothing if the datagram doesn't carry a valid TCP segment
+optional<TCPSegment> TCPOverIPv4Adapter::parse_tcp_in_ip( InternetDatagram& ip_dgram )
+{
+  // does the IPv4 datagram claim that its payload is a TCP segment?
+  if ( ip_dgram.header.proto != IPv4Header::PROTO_TCP ) {
+    return {};
+  }
+
+  // is the payload a valid TCP segment?
+  TCPSegment tcp_seg;
+  if ( not parse( tcp_seg, move( ip_dgram.payload ), ip_dgram.header.pseudo_checksum() ) ) {
+    return {};
+  }
+
+  // the ECN field of the datagram belongs to the segment it carries
+  tcp_seg.message.sender->ecn = ip_dgram.header.tos & TCPSenderMessage::ECN_MASK;
+
+  return tcp_seg;
+}
+
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
 //! \param[in] seg is the TCP segment to convert
+//! \note The datagram's payload may borrow the segment's payload, so `msg` must outlive it (clone() it to parse).
 InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( const TCPMessage& msg )
+{
+  InternetDatagram ip_dgram;
+  const TCPSegment seg = prepare_segment( msg, outbound_addresses(), ip_dgram.header );
+  ip_dgram.payload = serialize( seg );
+
+  return ip_dgram;
+}
+
+//! Like wrap_tcp_in_ip, but serializes only the IPv4 and TCP headers. The payload is not copied:
+//! the caller writes it (e.g. with writev) right after the returned buffers.
+vector<Ref<string>> TCPOverIPv4Adapter::wrap_tcp_headers( const TCPMessage& msg )
+{
+  return wrap_tcp_headers( msg, outbound_addresses() );
+}
+
+//! Like wrap_tcp_headers, but for a segment of any connection: `addresses` gives the source and destination
+vector<Ref<string>> TCPOverIPv4Adapter::wrap_tcp_headers( const TCPMessage& msg, const FourTuple& addresses )
+{
+  IPv4Header ip_header;
+  const TCPSegment seg = prepare_segment( msg, addresses, ip_header );
+
+  Serializer serializer;
+  ip_header.serialize( serializer );
+  seg.serialize_header( serializer );
+  return serializer.finish();
+}
+
+//! Sets the port numbers of a TCP segment and the addresses and length of its IPv4 header,
+//! and computes both checksums
+TCPSegment TCPOverIPv4Adapter::prepare_segment( const TCPMessage& msg,
+                                                const FourTuple& addresses,
+                                                IPv4Header& ip_header )
 {
   const size_t payload_size = msg.sender->payload.size();
   TCPSegment seg { .message = { msg.sender.borrow(), msg.receiver.borrow() } };
   // set the port numbers in the TCP segment
-  seg.udinfo.src_port = config().source.port();
-  seg.udinfo.dst_port = config().destination.port();
+  seg.udinfo.src_port = addresses.src_port;
+  seg.udinfo.dst_port = addresses.dst_port;
+  seg.build_options();
 
-  // create an Internet Datagram and set its addresses and length
-  InternetDatagram ip_dgram;
-  ip_dgram.header.src = config().source.ipv4_numeric();
-  ip_dgram.header.dst = config().destination.ipv4_numeric();
-  ip_dgram.header.len = ip_dgram.header.hlen * 4 + 20 /* tcp header len */ + payload_size;
+  // set the addresses and length of the Internet Datagram
+  ip_header.src = addresses.src_ip;
+  ip_header.dst = addresses.dst_ip;
+  ip_header.len = ip_header.hlen * 4 + seg.header_length() + payload_size;
+  ip_header.tos = msg.sender->ecn; // ECT(0) on data from an ECN-capable sender
 
-  // set payload, calculating TCP checksum using information from IP header
-  seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
-  ip_dgram.header.compute_checksum();
-  ip_dgram.payload = serialize( seg );
+  // calculate TCP checksum using information from IP header
+  seg.compute_checksum( ip_header.pseudo_checksum() );
+  ip_header.compute_checksum();
 
-  return ip_dgram;
+  return seg;
+}
+
+//! The addresses and ports of the connection, in the direction of a segment we send
+FourTuple TCPOverIPv4Adapter::outbound_addresses() const
+{
+  return { config().source.ipv4_numeric(),
+           config().source.port(),
+           config().destination.ipv4_numeric(),
+           config().destination.port() };
 }
@@ -1,10 +1,13 @@
 #pragma once
 
 #include "fd_adapter.hh"
+#include "four_tuple.hh"
 #include "ipv4_datagram.hh"
 #include "tcp_segment.hh"
 
 #include <optional>
+#include <string>
+#include <vector>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase
@@ -13,4 +16,17 @@ public:
   std::optional<TCPMessage> unwrap_tcp_in_ip( InternetDatagram ip_dgram );
 
   InternetDatagram wrap_tcp_in_ip( const TCPMessage& msg );
+
+  // Serialized IPv4 and TCP headers for `msg`; its payload is meant to be written after them, uncopied
+  std::vector<Ref<std::string>> wrap_tcp_headers( const TCPMessage& msg );
+
+  // The TCP segment carried by a datagram from any address (empty if it isn't a valid TCP segment)
+  static std::optional<TCPSegment> parse_tcp_in_ip( InternetDatagram& ip_dgram );
+
+  // Serialized IPv4 and TCP headers for `msg`, sent with the addresses and ports in `addresses`
+  static std::vector<Ref<std::string>> wrap_tcp_headers( const TCPMessage& msg, const FourTuple& addresses );
+
+private:
+  FourTuple outbound_addresses() const;
+  static TCPSegment prepare_segment( const TCPMessage& msg, const FourTuple& addresses, IPv4Header& ip_header );
 };
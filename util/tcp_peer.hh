@@ -6,35 +6,104 @@
 #include "tcp_segment.hh"
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
+#include "tcp_stats.hh"
 
+#include <algorithm>
 #include <functional>
 #include <optional>
+#include <span>
+#include <string>
+#include <vector>
 
 class TCPPeer
 {
-  auto make_send( const auto& transmit )
+public:
+  explicit TCPPeer( const TCPConfig& cfg ) : cfg_( cfg )
   {
-    return [&]( const TCPSenderMessage& x ) { send( x, transmit ); };
+    sender_.set_nagle( cfg_.nagle );
+    sender_.set_cork( cfg_.cork );
+    sender_.set_pacing( cfg_.pacing, cfg_.pacing_rate );
+    sender_.set_rack_tlp( cfg_.rack_tlp );
+    sender_.set_send_autotuning( cfg_.send_autotuning, cfg_.send_capacity_max );
+    receiver_.set_receive_autotuning( cfg_.recv_autotuning, cfg_.recv_capacity_max );
+    receiver_.set_sws_avoidance( cfg_.sws_avoidance, cfg_.mss );
+    sender_.set_timestamps( cfg_.timestamps ); // offer timestamps on our SYN
+    sender_.set_fast_open( cfg_.fast_open and cfg_.fast_open_cookie.has_value() ); // data on our SYN
   }
 
-public:
-  explicit TCPPeer( const TCPConfig& cfg ) : cfg_( cfg ) {}
-
   Writer& outbound_writer() { return sender_.writer(); }
   Reader& inbound_reader() { return receiver_.reader(); }
 
-  /* Type of the `transmit` function that the push and tick methods can use to send messages */
-  using TransmitFunction = std::function<void( TCPMessage )>;
+  /* Type of the `transmit` function that the push and tick methods use to send a batch of messages */
+  using TransmitFunction = std::function<void( std::span<const TCPMessage> )>;
 
   /* Passthrough methods */
-  void push( const TransmitFunction& transmit ) { sender_.push( make_send( transmit ) ); }
+  void push( const TransmitFunction& transmit )
+  {
+    sender_.push( batch_ );
+    send_batch( transmit );
+  }
   void tick( uint64_t t, const TransmitFunction& transmit )
   {
     cumulative_time_ += t;
-    sender_.tick( t, make_send( transmit ) );
+    receiver_.tick( t );
+    sender_.tick( t, batch_ );
+    // TCP Fast Open: our SYN waits to carry the first data written, but once time has passed without any (as
+    // when the server speaks first), it goes out alone.
+    if ( syn_deferred() and cumulative_time_ > 0 ) {
+      sender_.push( batch_ );
+    }
+    if ( delayed_ack_timer_.has_value() ) {
+      *delayed_ack_timer_ += t;
+      if ( *delayed_ack_timer_ >= cfg_.delayed_ack_timeout ) {
+        need_send_ = true;
+      }
+    }
+
+    // Once the application has read enough to open the window by a useful amount, tell the peer (only once).
+    if ( cfg_.sws_avoidance and has_ackno() and not receiver_.writer().is_closed()
+         and receiver_.window_edge() > advertised_window_edge_ ) {
+      need_send_ = true;
+    }
+
+    send_batch( transmit );
+    if ( need_send_ ) {
+      const TCPSenderMessage empty_message = sender_.make_empty_message();
+      batch_.emplace_back( empty_message );
+      send_batch( transmit );
+    }
   }
   bool has_ackno() const { return receiver_.send().ackno.has_value(); }
 
+  /* Has the three-way handshake completed (each side's SYN received and acknowledged)? */
+  bool established() const { return has_ackno() and sender_.syn_acked(); }
+
+  /* TCP Fast Open, as a server: the TCPPeer doesn't know the peer's address, so whoever does checks the cookie on
+     the peer's SYN against it before handing the SYN over. Data on the SYN is taken only if the cookie is `valid`;
+     otherwise `cookie`, the one for the peer's address, is issued on the SYN-ACK (if the peer asked for one). */
+  void verify_fast_open( bool valid, std::string cookie )
+  {
+    fast_open_valid_ = valid;
+    fast_open_issue_ = std::move( cookie );
+  }
+
+  /* TCP Fast Open: did the peer's SYN present the cookie issued to its address (so its data was taken)? */
+  bool fast_open_accepted() const { return fast_open_accepted_; }
+
+  /* TCP Fast Open: the cookie the peer issued on its SYN-ACK, to present on the next connection to it */
+  std::optional<std::string> fast_open_cookie() const
+  {
+    if ( opened_by_peer_ or not peer_syn_options_.has_value() or not peer_syn_options_->fast_open_cookie.has_value()
+         or peer_syn_options_->fast_open_cookie->empty() ) {
+      return {};
+    }
+    return peer_syn_options_->fast_open_cookie;
+  }
+
+  /* Small-segment coalescing controls (call push() afterwards to flush anything released) */
+  void set_nagle( bool enabled ) { sender_.set_nagle( enabled ); }
+  void set_cork( bool corked ) { sender_.set_cork( corked ); }
+
   /* Is the peer still active? */
   bool active() const
   {
@@ -47,41 +116,151 @@ public:
     return ( not any_errors ) and ( sender_active or receiver_active or lingering );
   }
 
+  /*
+   * How long until tick() next has work to do: the earliest of the retransmission, RACK and tail loss probe
+   * timers, the delayed ACK timer, and the end of lingering. Empty if no timer runs, so the peer needs no tick
+   * until it receives a segment or is pushed. Zero if it is no longer active, or uses a feature that does its
+   * work on every tick (buffer autotuning, pacing or window updates).
+   */
+  std::optional<uint64_t> next_timeout_ms() const
+  {
+    if ( not active() or cfg_.recv_autotuning or cfg_.send_autotuning or cfg_.pacing or cfg_.sws_avoidance ) {
+      return 0;
+    }
+
+    std::optional<uint64_t> next = sender_.next_timeout_ms();
+    const auto earliest
+      = [&next]( uint64_t remaining ) { next = std::min( next.value_or( remaining ), remaining ); };
+    if ( syn_deferred() ) {
+      earliest( 1 );
+    }
+    if ( delayed_ack_timer_.has_value() ) {
+      earliest( cfg_.delayed_ack_timeout - std::min<uint64_t>( *delayed_ack_timer_, cfg_.delayed_ack_timeout ) );
+    }
+    const bool streams_finished = sender_.reader().is_finished() and sender_.sequence_numbers_in_flight() == 0
+                                  and receiver_.writer().is_closed();
+    if ( streams_finished and linger_after_streams_finish_ ) {
+      earliest( time_of_last_receipt_ + 10UL * cfg_.rt_timeout - cumulative_time_ );
+    }
+    return next;
+  }
+
   void receive( TCPMessage msg, const TransmitFunction& transmit )
   {
+    // Header prediction (Van Jacobson): on an established connection, nearly every segment is either the next
+    // data in order with nothing new in its ACK, or a bare ACK of new data. Those skip the general path below.
+    if ( receiver_.predicts( msg.sender.get() ) ) {
+      const std::optional<uint64_t> newly_acked = sender_.predict_ack( msg.receiver.get() );
+      if ( newly_acked.has_value() ) {
+        const uint64_t payload_size = msg.sender->payload.size();
+        if ( payload_size > 0 and *newly_acked == 0 ) {
+          receive_predicted_data( std::move( msg ), payload_size, transmit );
+          return;
+        }
+        if ( payload_size == 0 and *newly_acked > 0 ) {
+          receive_predicted_ack( std::move( msg ), transmit );
+          return;
+        }
+      }
+    }
+
     if ( not active() ) {
       return;
     }
 
+    // TCP Fast Open (RFC 7413): when the peer opens the connection, data on its SYN is taken only with the cookie
+    // issued to its address (as checked by verify_fast_open). Otherwise the data is dropped here, and the peer
+    // sends it again after the handshake.
+    if ( msg.sender->SYN and not peer_syn_options_.has_value() ) {
+      opened_by_peer_ = sender_.sequence_numbers_in_flight() == 0 and not sender_.syn_acked();
+    }
+    if ( msg.sender->SYN and opened_by_peer_ and cfg_.fast_open ) {
+      fast_open_accepted_ = fast_open_valid_;
+      if ( not fast_open_accepted_ ) {
+        msg.sender->payload = {};
+        msg.sender->FIN = false;
+      }
+    }
+
     // Record time in case this peer has to linger after streams finish.
     time_of_last_receipt_ = cumulative_time_;
 
-    // If SenderMessage occupies a sequence number, make sure to reply.
-    need_send_ |= ( msg.sender->sequence_length() > 0 );
+    segments_received_++;
+    bytes_received_ += msg.sender->payload.size();
+
+    // The timestamps option is carried by the sender half of the message; note whether the peer's SYN offered it.
+    const bool peer_timestamps = msg.sender->tsval.has_value();
+
+    // ECN setup (RFC 3168): a SYN offers ECN with both ECE and CWR set, and a SYN-ACK accepts it with ECE alone.
+    const bool peer_ecn = msg.receiver->ECE and ( msg.sender->CWR != msg.receiver->ackno.has_value() );
+
+    const bool syn = msg.sender->SYN;
+    const bool fin = msg.sender->FIN;
+    const uint64_t sequence_length = msg.sender->sequence_length();
+    const uint64_t payload_size = msg.sender->payload.size();
 
     // If SenderMessage is a "keep-alive" (with intentionally invalid seqno), make sure to reply.
     // (N.B. orthodox TCP rules require a reply on any unacceptable segment.)
     const auto our_ackno = receiver_.send().ackno;
     need_send_ |= ( our_ackno.has_value() and msg.sender->seqno + 1 == our_ackno.value() );
 
-    // Give incoming TCPSenderMessage to receiver.
-    receiver_.receive( std::move( msg.sender ) );
+    // Note how the segment lines up with what was already received, to decide how soon to acknowledge it.
+    const bool gap_before = receiver_.reassembler().has_pending();
+    const uint64_t in_order_before = receiver_.in_order_segments();
+
+    // Give incoming TCPSenderMessage to receiver (moving its payload along, not copying it).
+    receiver_.receive( msg.sender.release() );
+
+    // If SenderMessage occupies a sequence number, make sure to reply (now, or soon with delayed ACKs).
+    if ( sequence_length > 0 ) {
+      const bool in_order = receiver_.in_order_segments() > in_order_before;
+      schedule_ack( payload_size, not in_order or gap_before or syn or fin );
+    }
 
     // Give incoming TCPReceiverMessage to sender.
     sender_.receive( msg.receiver );
 
-    // Send reply if needed.
-    push( transmit );
-    if ( need_send_ ) {
-      send( sender_.make_empty_message(), transmit );
+    // The peer's SYN carries the options it supports; agree on the ones both sides want.
+    // (This happens after the sender has seen the SYN's window, which is never scaled.)
+    if ( syn ) {
+      negotiate( msg.receiver.get(), peer_timestamps, peer_ecn );
     }
 
+    // Send reply if needed.
+    reply( transmit );
+
     // Did the inbound stream finish before the outbound stream? If so, no need to linger after streams finish.
     if ( receiver_.writer().is_closed() and not std::as_const( sender_ ).reader().is_finished() ) {
       linger_after_streams_finish_ = false;
     }
   }
 
+  /* Transport statistics for this connection */
+  TCPStats stats() const
+  {
+    return { .segments_sent = segments_sent_,
+             .bytes_sent = bytes_sent_,
+             .segments_received = segments_received_,
+             .bytes_received = bytes_received_,
+             .segments_in_order = receiver_.in_order_segments(),
+             .segments_out_of_order = receiver_.out_of_order_segments(),
+             .segments_duplicate = receiver_.duplicate_segments(),
+             .segments_beyond_window = receiver_.beyond_window_segments(),
+             .segments_retransmitted = sender_.retransmitted_segments(),
+             .bytes_retransmitted = sender_.retransmitted_bytes(),
+             .duplicate_acks = sender_.duplicate_acks(),
+             .zero_window_events = sender_.zero_window_events(),
+             .srtt_ms = sender_.srtt_ms(),
+             .rto_ms = sender_.current_RTO_ms(),
+             .send_window = sender_.window_size(),
+             .congestion_window = sender_.congestion_window(),
+             .receive_window = receiver_.window_edge() - receiver_.writer().bytes_pushed(),
+             .bytes_in_flight = sender_.sequence_numbers_in_flight(),
+             .reassembler_pending_bytes = receiver_.reassembler().count_bytes_pending(),
+             .rwnd_limited_ms = sender_.rwnd_limited_ms(),
+             .sndbuf_limited_ms = sender_.sndbuf_limited_ms() };
+  }
+
   // Testing interface
   const TCPReceiver& receiver() const { return receiver_; }
   const TCPSender& sender() const { return sender_; }
@@ -93,13 +272,220 @@ private:
 
   bool need_send_ {};
 
-  void send( const TCPSenderMessage& sender_message, const TransmitFunction& transmit )
+  // Delayed ACKs (RFC 1122, RFC 5681): unacknowledged in-order bytes, and how long the oldest has waited
+  uint64_t unacked_bytes_ {};
+  uint64_t largest_payload_ {}; // the size of the peer's full-sized segments, as far as we can tell
+  std::optional<uint64_t> delayed_ack_timer_ {};
+
+  // Right edge of the receive window in the last segment sent (a window update is due when it can move)
+  uint64_t advertised_window_edge_ {};
+  unsigned quick_acks_left_ { cfg_.quick_acks };
+
+  // Acknowledge a segment that occupies sequence space. Out-of-order data, data that fills a gap, SYN and FIN
+  // are ACKed right away (so the peer's loss recovery and close aren't held up), as is everything until the
+  // quick-ACK segments at the start of the connection are used up. Otherwise the ACK waits for a second
+  // full-sized segment, for data going the other way, or for the timeout.
+  void schedule_ack( uint64_t payload_size, bool immediate )
   {
-    transmit( { borrow( sender_message ), receiver_.send() } );
+    // A coalesced segment is larger than any segment the peer sent; it counts as the full-sized ones it joins.
+    largest_payload_ = std::max( largest_payload_, std::min<uint64_t>( payload_size, cfg_.mss ) );
+    if ( not cfg_.delayed_ack or immediate ) {
+      need_send_ = true;
+      return;
+    }
+    if ( quick_acks_left_ > 0 ) {
+      --quick_acks_left_;
+      need_send_ = true;
+      return;
+    }
+
+    unacked_bytes_ += payload_size;
+    if ( unacked_bytes_ >= 2 * largest_payload_ ) {
+      need_send_ = true;
+    } else if ( not delayed_ack_timer_.has_value() ) {
+      delayed_ack_timer_ = 0;
+    }
+  }
+
+  // Send whatever the sender has to send, and a bare ACK if that didn't carry one and one is due.
+  void reply( const TransmitFunction& transmit )
+  {
+    push( transmit );
+    if ( need_send_ ) {
+      const TCPSenderMessage empty_message = sender_.make_empty_message();
+      batch_.emplace_back( empty_message );
+      send_batch( transmit );
+    }
+  }
+
+  // Header prediction, in-order data: deliver the payload and schedule the ACK. The ACK it carries acknowledges
+  // nothing new, but the sender still sees it, as on the general path: it counts as a duplicate ACK while data is
+  // in flight, and may show a loss, so the statistics and recovery don't depend on which path was taken.
+  void receive_predicted_data( TCPMessage msg, uint64_t payload_size, const TransmitFunction& transmit )
+  {
+    time_of_last_receipt_ = cumulative_time_;
+    segments_received_++;
+    bytes_received_ += payload_size;
+
+    receiver_.receive_predicted( msg.sender.release() );
+    schedule_ack( payload_size, false );
+    sender_.receive( msg.receiver );
+    reply( transmit );
+  }
+
+  // Header prediction, bare ACK of new data: nothing for the receiver to do but echo the timestamp; the sender
+  // frees acknowledged data and may send more.
+  void receive_predicted_ack( TCPMessage msg, const TransmitFunction& transmit )
+  {
+    time_of_last_receipt_ = cumulative_time_;
+    segments_received_++;
+
+    receiver_.receive_predicted( msg.sender.release() );
+    sender_.receive( msg.receiver );
+    reply( transmit );
+  }
+
+  // Options received on the peer's SYN (empty until the SYN arrives)
+  std::optional<TCPReceiverMessage> peer_syn_options_ {};
+
+  // ECN agreed on the SYN exchange
+  bool ecn_ {};
+
+  // Did the peer's SYN open the connection (arriving before we sent ours), and did it carry a valid cookie?
+  bool opened_by_peer_ {};
+  bool fast_open_accepted_ {};
+
+  // As a server, the verdict on the peer's Fast Open cookie, and the cookie to issue it (see verify_fast_open)
+  bool fast_open_valid_ {};
+  std::string fast_open_issue_ {};
+
+  // TCP Fast Open: is our SYN being held back to carry the first data written? (see tick)
+  bool syn_deferred() const
+  {
+    return cfg_.fast_open and cfg_.fast_open_cookie.has_value() and not sender_.syn_sent();
+  }
+
+  void negotiate( const TCPReceiverMessage& syn_options, bool peer_timestamps, bool peer_ecn )
+  {
+    peer_syn_options_ = syn_options;
+    ecn_ = cfg_.ecn and peer_ecn;
+    sender_.set_ecn( ecn_ );
+    sender_.set_fast_open( false ); // the peer's window is known now (and our SYN, if any, has gone out)
+    receiver_.set_ecn( ecn_ );
+    receiver_.set_sack_enabled( cfg_.sack and syn_options.sack_permitted );
+    sender_.set_timestamps( cfg_.timestamps and peer_timestamps );
+    receiver_.set_timestamps( cfg_.timestamps and peer_timestamps );
+    if ( cfg_.window_scale and syn_options.window_scale.has_value() ) {
+      receiver_.set_window_shift( receive_window_shift() );
+      sender_.set_window_shift( std::min( *syn_options.window_scale, TCPReceiverMessage::MAX_WINDOW_SCALE ) );
+    }
+
+    // Send no more than the peer will accept (a peer that doesn't say gets the default size).
+    const uint64_t peer_mss = syn_options.mss.value_or( TCPConfig::MAX_PAYLOAD_SIZE );
+    const uint64_t send_mss = std::min<uint64_t>( cfg_.mss, peer_mss );
+    if ( cfg_.mtu_probing ) {
+      sender_.set_mss( std::min<uint64_t>( send_mss, TCPConfig::MAX_PAYLOAD_SIZE ) );
+      sender_.enable_mtu_probing( send_mss );
+    } else {
+      sender_.set_mss( send_mss );
+    }
+  }
+
+  // Smallest shift count that lets the whole receive capacity (as far as autotuning may grow it)
+  // be advertised in 16 bits
+  uint8_t receive_window_shift() const
+  {
+    const uint64_t capacity = std::max( cfg_.recv_capacity, cfg_.recv_autotuning ? cfg_.recv_capacity_max : 0 );
+    uint8_t shift = 0;
+    while ( shift < TCPReceiverMessage::MAX_WINDOW_SCALE and ( capacity >> shift ) > UINT16_MAX ) {
+      ++shift;
+    }
+    return shift;
+  }
+
+  // Options to offer on our own SYN. If the peer's SYN has already arrived, only offer what it offered.
+  void add_syn_options( TCPReceiverMessage& msg ) const
+  {
+    const bool peer_sack = not peer_syn_options_.has_value() or peer_syn_options_->sack_permitted;
+    msg.sack_permitted = cfg_.sack and peer_sack;
+
+    msg.mss = cfg_.mss;
+
+    msg.ECE = cfg_.ecn and ( not peer_syn_options_.has_value() or ecn_ );
+
+    const bool peer_window_scale = not peer_syn_options_.has_value() or peer_syn_options_->window_scale.has_value();
+    if ( cfg_.window_scale and peer_window_scale ) {
+      msg.window_scale = receive_window_shift();
+    }
+
+    // TCP Fast Open: present our cookie on our SYN (or ask for one); issue a cookie on the SYN-ACK to a peer that
+    // asked for one or presented one that isn't valid.
+    if ( cfg_.fast_open and not peer_syn_options_.has_value() ) {
+      msg.fast_open_cookie = cfg_.fast_open_cookie.value_or( std::string {} );
+    } else if ( cfg_.fast_open and peer_syn_options_->fast_open_cookie.has_value() and not fast_open_accepted_
+                and not fast_open_issue_.empty() ) {
+      msg.fast_open_cookie = fast_open_issue_;
+    }
+
+    // The window in a SYN segment is never scaled.
+    msg.window_size = static_cast<uint16_t>(
+      std::min( receiver_.writer().available_capacity(), static_cast<uint64_t>( UINT16_MAX ) ) );
+  }
+
+  // Segments produced by the sender, and the messages built from them (reused across calls)
+  TCPSender::Batch batch_ {};
+  std::vector<TCPMessage> messages_ {};
+  TCPReceiverMessage receiver_message_ {};
+
+  // Pair each pending segment with the receiver's current state and hand them all over in one call
+  void send_batch( const TransmitFunction& transmit )
+  {
+    if ( batch_.empty() ) {
+      return;
+    }
+
+    // All segments in a batch carry the same acknowledgment, so compute it once and borrow it.
+    receiver_message_ = receiver_.send();
+    receiver_.sent( receiver_message_ );
+    advertised_window_edge_ = receiver_.window_edge();
+    for ( const TCPSenderMessage& sender_message : batch_ ) {
+      if ( sender_message.SYN ) {
+        TCPReceiverMessage syn_receiver_message = receiver_message_;
+        add_syn_options( syn_receiver_message );
+        if ( cfg_.ecn and not peer_syn_options_.has_value() ) {
+          // An ECN-setup SYN also sets CWR, which belongs to the sender half of the message.
+          TCPSenderMessage syn_sender_message = sender_message;
+          syn_sender_message.CWR = true;
+          messages_.push_back( { std::move( syn_sender_message ), std::move( syn_receiver_message ) } );
+        } else {
+          messages_.push_back( { borrow( sender_message ), std::move( syn_receiver_message ) } );
+        }
+      } else {
+        messages_.push_back( { borrow( sender_message ), borrow( receiver_message_ ) } );
+      }
+    }
+    batch_.clear();
+
+    segments_sent_ += messages_.size();
+    for ( const TCPMessage& message : messages_ ) {
+      bytes_sent_ += message.sender->payload.size();
+    }
+
+    transmit( messages_ );
+    messages_.clear();
+
+    // Every segment carries the latest acknowledgment, so nothing is left to delay.
     need_send_ = false;
+    unacked_bytes_ = 0;
+    delayed_ack_timer_.reset();
   }
 
   bool linger_after_streams_finish_ { true }; // one peer may need to linger to make sure all closure conditions met
   uint64_t cumulative_time_ {};
   uint64_t time_of_last_receipt_ {};
+
+  uint64_t segments_sent_ {};
+  uint64_t bytes_sent_ {};
+  uint64_t segments_received_ {};
+  uint64_t bytes_received_ {};
 };
@@ -2,7 +2,20 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstddef>
 #include <optional>
+#include <string>
+#include <vector>
+
+/*
+ * A SACKBlock describes one contiguous range of sequence numbers, [begin, end), that the TCP receiver
+ * has received but cannot yet acknowledge cumulatively (RFC 2018).
+ */
+struct SACKBlock
+{
+  Wrap32 begin { 0 };
+  Wrap32 end { 0 };
+};
 
 /*
  * The TCPReceiverMessage structure contains the information sent from a TCP receiver to its sender.
@@ -17,6 +30,27 @@
  *    the <cstdint> header).
  *
  * 3) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * It may also carry TCP options:
+ *
+ * - sack: selective acknowledgment blocks, the ranges above the ackno that have already arrived.
+ *   The first block contains the most recently received segment.
+ *
+ * - sack_permitted: only meaningful on a SYN segment. The endpoint can process selective acknowledgments.
+ *
+ * - window_scale: only meaningful on a SYN segment. The shift count (RFC 7323) the endpoint will apply to
+ *   the windows it advertises once both sides have offered the option. The window on a SYN is never scaled.
+ *
+ * - mss: only meaningful on a SYN segment. The largest payload the endpoint is willing to receive.
+ *
+ * - tsecr: the timestamp echo (RFC 7323), the most recent TSval received from the peer's sender.
+ *
+ * - fast_open_cookie: only meaningful on a SYN segment. The TCP Fast Open option (RFC 7413): on a SYN, the
+ *   cookie that vouches for the data it carries, or empty to ask for a cookie; on a SYN-ACK, a cookie for the
+ *   peer to present on its next connection.
+ *
+ * And the ECE flag (RFC 3168). On a SYN it offers or accepts ECN; afterwards it echoes a congestion mark
+ * (CE) until the peer's sender answers with CWR.
  */
 
 struct TCPReceiverMessage
@@ -24,4 +58,17 @@ struct TCPReceiverMessage
   std::optional<Wrap32> ackno {};
   uint16_t window_size {};
   bool RST {};
+
+  std::vector<SACKBlock> sack {};
+  bool sack_permitted {};
+  std::optional<uint8_t> window_scale {};
+  std::optional<uint16_t> mss {};
+  std::optional<uint32_t> tsecr {};
+  std::optional<std::string> fast_open_cookie {};
+  bool ECE {};
+
+  static constexpr size_t MAX_SACK_BLOCKS = 4;   // at most four blocks fit in the TCP option space
+  static constexpr uint8_t MAX_WINDOW_SCALE = 14; // largest shift count allowed by RFC 7323
+  static constexpr size_t MIN_FAST_OPEN_COOKIE = 4; // cookie lengths allowed by RFC 7413
+  static constexpr size_t MAX_FAST_OPEN_COOKIE = 16;
 };
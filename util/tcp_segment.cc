@@ -3,12 +3,183 @@
 #include "helpers.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
 
 static_assert( !( TCPSegment::HEADER_LENGTH & 0x03 ) ); // header length must be divisible by 4
 
+namespace {
+// TCP option kinds (https://www.iana.org/assignments/tcp-parameters)
+constexpr uint8_t OPT_EOL = 0;
+constexpr uint8_t OPT_NOP = 1;
+constexpr uint8_t OPT_MSS = 2;
+constexpr uint8_t OPT_WINDOW_SCALE = 3;
+constexpr uint8_t OPT_SACK_PERMITTED = 4;
+constexpr uint8_t OPT_SACK = 5;
+constexpr uint8_t OPT_TIMESTAMPS = 8;
+constexpr uint8_t OPT_FAST_OPEN = 34;
+
+constexpr size_t MAX_OPTIONS_LENGTH = 40; // data offset is 4 bits, counted in 32-bit words
+
+class Wrap32Serializable : public Wrap32
+{
+public:
+  uint32_t raw_value() const { return raw_value_; }
+};
+
+void put_integer( string& out, std::unsigned_integral auto val )
+{
+  for ( size_t i = sizeof( val ); i > 0; --i ) {
+    out.push_back( static_cast<char>( static_cast<uint8_t>( val >> ( ( i - 1 ) * 8 ) ) ) );
+  }
+}
+
+template<std::unsigned_integral T>
+T get_integer( string_view in )
+{
+  T ret = 0;
+  for ( size_t i = 0; i < sizeof( ret ); ++i ) {
+    ret = ( ret << 8 ) | static_cast<uint8_t>( in[i] );
+  }
+  return ret;
+}
+
+void parse_options( string_view options, TCPMessage& message )
+{
+  while ( not options.empty() ) {
+    const uint8_t kind = options.front();
+    if ( kind == OPT_EOL ) {
+      return;
+    }
+    if ( kind == OPT_NOP ) {
+      options.remove_prefix( 1 );
+      continue;
+    }
+
+    // every other option has a length byte that includes the kind and length bytes
+    if ( options.size() < 2 or static_cast<uint8_t>( options[1] ) < 2
+         or static_cast<uint8_t>( options[1] ) > options.size() ) {
+      return; // malformed option list: ignore the rest
+    }
+    const string_view body = options.substr( 2, static_cast<uint8_t>( options[1] ) - 2 );
+    options.remove_prefix( static_cast<uint8_t>( options[1] ) );
+
+    switch ( kind ) {
+      case OPT_MSS:
+        if ( body.size() == 2 ) {
+          message.receiver->mss = get_integer<uint16_t>( body );
+        }
+        break;
+      case OPT_WINDOW_SCALE:
+        if ( body.size() == 1 ) {
+          message.receiver->window_scale = static_cast<uint8_t>( body.front() );
+        }
+        break;
+      case OPT_SACK_PERMITTED:
+        message.receiver->sack_permitted = true;
+        break;
+      case OPT_SACK:
+        for ( auto blocks = body; blocks.size() >= 8; blocks.remove_prefix( 8 ) ) {
+          message.receiver->sack.push_back( { Wrap32 { get_integer<uint32_t>( blocks ) },
+                                              Wrap32 { get_integer<uint32_t>( blocks.substr( 4 ) ) } } );
+        }
+        break;
+      case OPT_TIMESTAMPS:
+        if ( body.size() == 8 ) {
+          message.sender->tsval = get_integer<uint32_t>( body );
+          if ( message.receiver->ackno.has_value() ) { // TSecr is only valid on an ACK
+            message.receiver->tsecr = get_integer<uint32_t>( body.substr( 4 ) );
+          }
+        }
+        break;
+      case OPT_FAST_OPEN:
+        if ( body.empty()
+             or ( body.size() >= TCPReceiverMessage::MIN_FAST_OPEN_COOKIE
+                  and body.size() <= TCPReceiverMessage::MAX_FAST_OPEN_COOKIE and body.size() % 2 == 0 ) ) {
+          message.receiver->fast_open_cookie = string { body };
+        }
+        break;
+      default:
+        break; // unknown option: skip
+    }
+  }
+}
+
+// Serialize the options carried by a message, padded to a multiple of four bytes.
+string serialize_options( const TCPMessage& message )
+{
+  string out;
+
+  if ( message.sender->SYN and message.receiver->mss.has_value() ) {
+    put_integer( out, OPT_MSS );
+    put_integer( out, uint8_t { 4 } );
+    put_integer( out, *message.receiver->mss );
+  }
+
+  // With timestamps, SACK-permitted takes the place of the two NOPs that align them (as Linux lays out a SYN),
+  // so that every SYN option, and the longest Fast Open cookie, fit together: 4 + 4 + 12 + 18 = 38 bytes.
+  const bool sack_permitted = message.sender->SYN and message.receiver->sack_permitted;
+  if ( sack_permitted and not message.sender->tsval.has_value() ) {
+    put_integer( out, OPT_NOP );
+    put_integer( out, OPT_NOP );
+    put_integer( out, OPT_SACK_PERMITTED );
+    put_integer( out, uint8_t { 2 } );
+  }
+
+  if ( message.sender->SYN and message.receiver->window_scale.has_value() ) {
+    put_integer( out, OPT_NOP );
+    put_integer( out, OPT_WINDOW_SCALE );
+    put_integer( out, uint8_t { 3 } );
+    put_integer( out, *message.receiver->window_scale );
+  }
+
+  if ( message.sender->tsval.has_value() ) {
+    if ( sack_permitted ) {
+      put_integer( out, OPT_SACK_PERMITTED );
+      put_integer( out, uint8_t { 2 } );
+    } else {
+      put_integer( out, OPT_NOP );
+      put_integer( out, OPT_NOP );
+    }
+    put_integer( out, OPT_TIMESTAMPS );
+    put_integer( out, uint8_t { 10 } );
+    put_integer( out, *message.sender->tsval );
+    put_integer( out, message.receiver->tsecr.value_or( 0 ) );
+  }
+
+  // Room is always left for the cookie (see above); only one longer than RFC 7413 allows, which no server
+  // issues, is left off rather than overflow the header.
+  static_assert( 4 + 4 + 12 + 2 + TCPReceiverMessage::MAX_FAST_OPEN_COOKIE <= MAX_OPTIONS_LENGTH );
+  if ( message.sender->SYN and message.receiver->fast_open_cookie.has_value()
+       and message.receiver->fast_open_cookie->size() <= TCPReceiverMessage::MAX_FAST_OPEN_COOKIE ) {
+    const string& cookie = *message.receiver->fast_open_cookie;
+    put_integer( out, OPT_FAST_OPEN );
+    put_integer( out, static_cast<uint8_t>( 2 + cookie.size() ) );
+    out.append( cookie );
+  }
+
+  const size_t room = ( MAX_OPTIONS_LENGTH - min( out.size() + 4, MAX_OPTIONS_LENGTH ) ) / 8;
+  const size_t blocks = min( { message.receiver->sack.size(), room, TCPReceiverMessage::MAX_SACK_BLOCKS } );
+  if ( blocks ) {
+    put_integer( out, OPT_NOP );
+    put_integer( out, OPT_NOP );
+    put_integer( out, OPT_SACK );
+    put_integer( out, static_cast<uint8_t>( 2 + 8 * blocks ) );
+    for ( size_t i = 0; i < blocks; ++i ) {
+      put_integer( out, Wrap32Serializable { message.receiver->sack[i].begin }.raw_value() );
+      put_integer( out, Wrap32Serializable { message.receiver->sack[i].end }.raw_value() );
+    }
+  }
+
+  while ( out.size() % 4 ) {
+    put_integer( out, OPT_EOL );
+  }
+  return out;
+}
+} // namespace
+
 void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
 {
   /* verify checksum */
@@ -40,6 +211,8 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
     message.receiver->ackno.reset(); // no ACK
   }
 
+  message.sender->CWR = octet & 0b1000'0000;
+  message.receiver->ECE = octet & 0b0100'0000;
   message.sender->RST = message.receiver->RST = octet & 0b0000'0100;
   message.sender->SYN = octet & 0b0000'0010;
   message.sender->FIN = octet & 0b0000'0001;
@@ -48,47 +221,67 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
   parser.integer( udinfo.cksum );
   parser.integer( raw16 ); // urgent pointer
 
-  // skip any options or anything extra in the header
+  // parse any options in the header
   if ( data_offset < ( HEADER_LENGTH >> 2 ) ) {
     parser.set_error();
     return;
   }
-  parser.remove_prefix( data_offset * 4 - HEADER_LENGTH );
+  options.assign( data_offset * 4 - HEADER_LENGTH, 0 );
+  parser.string( options );
+  if ( parser.has_error() ) {
+    return;
+  }
+  parse_options( options, message );
 
-  parser.concatenate_all_remaining( message.sender->payload );
+  // the payload shares the buffer it was read into
+  parser.all_remaining( message.sender->payload );
 }
 
-class Wrap32Serializable : public Wrap32
+size_t TCPSegment::header_length() const
 {
-public:
-  uint32_t raw_value() const { return raw_value_; }
-};
+  return HEADER_LENGTH + options.size();
+}
+
+void TCPSegment::build_options()
+{
+  options = serialize_options( message );
+}
 
 void TCPSegment::serialize( Serializer& serializer ) const
+{
+  serialize_header( serializer );
+  serializer.buffer( message.sender->payload );
+}
+
+void TCPSegment::serialize_header( Serializer& serializer ) const
 {
   serializer.integer( udinfo.src_port );
   serializer.integer( udinfo.dst_port );
   serializer.integer( Wrap32Serializable { message.sender->seqno }.raw_value() );
   serializer.integer( Wrap32Serializable { message.receiver->ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { ( HEADER_LENGTH >> 2 ) << 4 } ); // data offset
+  serializer.integer( static_cast<uint8_t>( ( ( HEADER_LENGTH + options.size() ) >> 2 ) << 4 ) ); // data offset
   const bool reset = message.sender->RST or message.receiver->RST;
-  const uint8_t flags = ( message.receiver->ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
+  const uint8_t flags = ( message.sender->CWR ? 0b1000'0000U : 0 ) | ( message.receiver->ECE ? 0b0100'0000U : 0 )
+                        | ( message.receiver->ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
                         | ( message.sender->SYN ? 0b0000'0010U : 0 ) | ( message.sender->FIN ? 0b0000'0001U : 0 );
   serializer.integer( flags );
   serializer.integer( message.receiver->window_size );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
-  serializer.buffer( message.sender->payload );
+  for ( const char ch : options ) {
+    serializer.integer( static_cast<uint8_t>( ch ) );
+  }
 }
 
 void TCPSegment::compute_checksum( uint32_t datagram_layer_pseudo_checksum )
 {
   udinfo.cksum = 0;
   Serializer s;
-  serialize( s );
+  serialize_header( s );
 
   InternetChecksum check { datagram_layer_pseudo_checksum };
   check.add( s.finish() );
+  check.add( message.sender.get().payload.view() ); // the message may be borrowed
   udinfo.cksum = check.value();
 }
 
@@ -109,11 +302,36 @@ string TCPSegment::to_string() const
   if ( message.sender->RST or message.receiver->RST ) {
     ss << " +RST";
   }
+  if ( message.receiver->ECE ) {
+    ss << " +ECE";
+  }
+  if ( message.sender->CWR ) {
+    ss << " +CWR";
+  }
   auto ackno = message.receiver->ackno;
   if ( ackno.has_value() ) {
     ss << " ACK<" << Wrap32Serializable { *ackno }.raw_value() << ">";
   }
   ss << " winsize=" << message.receiver->window_size;
+  if ( message.receiver->sack_permitted ) {
+    ss << " +SACK_PERM";
+  }
+  if ( message.receiver->mss.has_value() ) {
+    ss << " MSS=" << *message.receiver->mss;
+  }
+  if ( message.sender->tsval.has_value() ) {
+    ss << " TS<" << *message.sender->tsval << "," << message.receiver->tsecr.value_or( 0 ) << ">";
+  }
+  if ( message.receiver->window_scale.has_value() ) {
+    ss << " WS=" << static_cast<unsigned>( *message.receiver->window_scale );
+  }
+  if ( message.receiver->fast_open_cookie.has_value() ) {
+    ss << " TFO<" << message.receiver->fast_open_cookie->size() << " bytes>";
+  }
+  for ( const auto& block : message.receiver->sack ) {
+    ss << " SACK<" << Wrap32Serializable { block.begin }.raw_value() << "-"
+       << Wrap32Serializable { block.end }.raw_value() << ">";
+  }
   ss << " src=" << udinfo.src_port << " dst=" << udinfo.dst_port;
   return ss.str();
 }
@@ -22,13 +22,26 @@ struct TCPSegment
   TCPMessage message {};
   UserDatagramInfo udinfo {};
 
+  // The header options, as serialized. Like the checksum, they are derived from the message: build_options()
+  // sets them (and parse() keeps the ones it read), so they are built once however often the header is written.
+  std::string options {};
+
   void parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum );
   void serialize( Serializer& serializer ) const;
 
+  // Serialize only the TCP header (with options), leaving the payload to be written after it without a copy
+  void serialize_header( Serializer& serializer ) const;
+
+  // Build `options` from the message; call again if the message changes
+  void build_options();
+
   void compute_checksum( uint32_t datagram_layer_pseudo_checksum );
 
   static constexpr uint8_t HEADER_LENGTH = 20; // TCP header length, not including options
 
+  // TCP header length including options (as serialized)
+  size_t header_length() const;
+
   // Return a string containing a summary in human-readable format
   std::string to_string() const;
 };
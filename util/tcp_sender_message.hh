@@ -1,8 +1,9 @@
 #pragma once
 
+#include "slice.hh"
 #include "wrapping_integers.hh"
 
-#include <string>
+#include <optional>
 
 /*
  * The TCPSenderMessage structure contains the information sent from a TCP sender to its receiver.
@@ -15,11 +16,19 @@
  * 2) The SYN flag. If set, this segment is the beginning of the byte stream, and the seqno field
  *    contains the Initial Sequence Number (ISN) -- the zero point.
  *
- * 3) The payload: a substring (possibly empty) of the byte stream.
+ * 3) The payload: a substring (possibly empty) of the byte stream. It is a Slice, so it may share its bytes
+ *    with the sender's buffer and with other copies of the message.
  *
  * 4) The FIN flag. If set, the payload represents the ending of the byte stream.
  *
  * 5) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * It may also carry the TSval of the timestamps option (RFC 7323): the sender's clock when the segment was
+ * (re)transmitted. The peer's receiver echoes it back in TCPReceiverMessage::tsecr.
+ *
+ * For ECN (RFC 3168) it carries the CWR flag, set once the sender has reduced its congestion window after an
+ * ECE echo, and the ECN codepoint of the IP datagram: ECT(0) when sent by an ECN-capable sender, or CE when
+ * a router on the path has marked it instead of dropping it.
  */
 
 struct TCPSenderMessage
@@ -27,11 +36,21 @@ struct TCPSenderMessage
   Wrap32 seqno { 0 };
 
   bool SYN {};
-  std::string payload {};
+  Slice payload {};
   bool FIN {};
 
   bool RST {};
 
+  std::optional<uint32_t> tsval {};
+
+  bool CWR {};
+  uint8_t ecn {};
+
+  static constexpr uint8_t ECN_NOT_ECT = 0b00; // not ECN-capable
+  static constexpr uint8_t ECN_ECT0 = 0b10;    // ECN-capable transport, ECT(0)
+  static constexpr uint8_t ECN_CE = 0b11;      // congestion experienced
+  static constexpr uint8_t ECN_MASK = 0b11;    // the ECN field is the low two bits of the IPv4 TOS byte
+
   // How many sequence numbers does this segment use?
   uint64_t sequence_length() const { 
     return payload.size() + (SYN ? 1 : 0) + (FIN ? 1 : 0); 
@@ -0,0 +1,234 @@
+#pragma once
+
+#include "address.hh"
+#include "eventloop.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "four_tuple.hh"
+#include "tcp_config.hh"
+#include "tcp_demux.hh"
+#include "tuntap_adapter.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * Terminates TCP connections over the queues of a multi-queue interface, with one thread per queue.
+ *
+ * Each queue belongs to a shard: a thread running its own EventLoop and its own TCPOverIPv4Demultiplexer.
+ * A connection is owned by the shard its four-tuple hashes to, so all of its segments are handled on one
+ * thread, and no connection state is shared between threads. The kernel picks the queue a datagram
+ * arrives on by its own flow hash, so a shard that reads a segment for a connection it doesn't own hands
+ * it to the owner through the owner's inbox. Replies go out on the owner's queue.
+ *
+ * For a TUN device created with `multi_queue`, open one queue per core:
+ *
+ *     std::vector<FileDescriptor> queues;
+ *     for ( unsigned i = 0; i < std::thread::hardware_concurrency(); i++ ) {
+ *       queues.emplace_back( TunFD { "tun144", true } );
+ *     }
+ *     ShardedTCPOverIPv4Stack stack { cfg, std::move( queues ) };
+ */
+class ShardedTCPOverIPv4Stack
+{
+public:
+  //! Runs on the thread of the shard that owns a connection
+  using Task = std::function<void( TCPOverIPv4Demultiplexer& )>;
+
+  static constexpr uint64_t TICK_MS = 10;
+  static constexpr size_t MAX_BATCH = 64; // datagrams read from a queue per wakeup
+
+  //! Start one shard per queue (each queue is read and written only by its own shard's thread)
+  ShardedTCPOverIPv4Stack( const TCPConfig& cfg, std::vector<FileDescriptor> queues )
+  {
+    if ( queues.empty() ) {
+      throw std::runtime_error( "ShardedTCPOverIPv4Stack needs at least one queue" );
+    }
+    shards_.reserve( queues.size() );
+    for ( auto& queue : queues ) {
+      shards_.push_back( std::make_unique<Shard>( cfg, std::move( queue ) ) );
+    }
+    for ( size_t index = 0; index < shards_.size(); index++ ) {
+      Shard& shard = *shards_[index];
+      shard.thread = std::thread( [this, &shard] { run( shard ); } );
+    }
+  }
+
+  ~ShardedTCPOverIPv4Stack()
+  {
+    stopping_ = true;
+    for ( auto& shard : shards_ ) {
+      shard->wake();
+      shard->thread.join();
+    }
+  }
+
+  // The shards' threads refer to the stack
+  ShardedTCPOverIPv4Stack( const ShardedTCPOverIPv4Stack& other ) = delete;
+  ShardedTCPOverIPv4Stack& operator=( const ShardedTCPOverIPv4Stack& other ) = delete;
+
+  size_t shard_count() const { return shards_.size(); }
+
+  //! The shard that owns the connection named by the addresses and ports on a segment arriving from its peer
+  size_t shard_of( const FourTuple& addresses ) const { return addresses.hash() % shards_.size(); }
+
+  //! Accept connections to `port` on every shard. `on_accept` runs on the thread of the connection's shard.
+  void listen( uint16_t port, const TCPOverIPv4Demultiplexer::AcceptFunction& on_accept = {} )
+  {
+    for ( auto& shard : shards_ ) {
+      shard->post( [port, on_accept]( TCPOverIPv4Demultiplexer& demux ) { demux.listen( port, on_accept ); } );
+    }
+  }
+
+  //! Open a connection from `local` to `remote` on the shard that will own it
+  void connect( const Address& local, const Address& remote )
+  {
+    post( { remote.ipv4_numeric(), remote.port(), local.ipv4_numeric(), local.port() },
+          [local, remote]( TCPOverIPv4Demultiplexer& demux ) { demux.connect( local, remote ); } );
+  }
+
+  //! Run `task` on the thread of the shard that owns the connection named by `addresses` (e.g. to read
+  //! from or write to that connection's streams)
+  void post( const FourTuple& addresses, Task task ) { shards_[shard_of( addresses )]->post( std::move( task ) ); }
+
+  //! Segments that arrived on one shard's queue and were handed to the shard that owns their connection
+  uint64_t handed_off_segments() const { return handed_off_segments_; }
+
+private:
+  struct Shard
+  {
+    FileDescriptor queue;
+    TCPOverIPv4Demultiplexer demux;
+    FileDescriptor wakeup { CheckSystemCall( "eventfd", eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) };
+
+    // The inbox, filled by other threads
+    std::mutex mutex {};
+    std::vector<std::pair<FourTuple, TCPMessage>> segments {};
+    std::deque<Task> tasks {};
+
+    std::thread thread {};
+
+    Shard( const TCPConfig& cfg, FileDescriptor&& s_queue )
+      : queue( std::move( s_queue ) )
+      , demux( cfg, [this]( const std::vector<std::string_view>& buffers ) { queue.write( buffers ); } )
+    {
+      queue.set_blocking( false );
+    }
+
+    void wake()
+    {
+      const uint64_t one = 1;
+      wakeup.write( std::string_view { reinterpret_cast<const char*>( &one ), sizeof( one ) } );
+    }
+
+    void post( Task task )
+    {
+      {
+        const std::lock_guard lock { mutex };
+        tasks.push_back( std::move( task ) );
+      }
+      wake();
+    }
+
+    void hand_off( std::vector<std::pair<FourTuple, TCPMessage>>& batch )
+    {
+      {
+        const std::lock_guard lock { mutex };
+        for ( auto& segment : batch ) {
+          segments.push_back( std::move( segment ) );
+        }
+      }
+      batch.clear();
+      wake();
+    }
+
+    // Take what other threads have left in the inbox, and handle it on this shard's thread
+    void drain_inbox()
+    {
+      std::string counter;
+      wakeup.read( counter );
+
+      std::vector<std::pair<FourTuple, TCPMessage>> arrived;
+      std::deque<Task> todo;
+      {
+        const std::lock_guard lock { mutex };
+        std::swap( arrived, segments );
+        std::swap( todo, tasks );
+      }
+      for ( auto& task : todo ) {
+        task( demux );
+      }
+      demux.receive( std::move( arrived ) );
+    }
+  };
+
+  std::vector<std::unique_ptr<Shard>> shards_ {};
+  std::atomic<bool> stopping_ {};
+  std::atomic<uint64_t> handed_off_segments_ {};
+
+  static uint64_t timestamp_ms()
+  {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch() )
+      .count();
+  }
+
+  // Read the datagrams waiting in the shard's queue (up to a batch), and handle each segment here or hand it to
+  // the shard that owns its connection. Each shard gets its part of the batch at once, to coalesce.
+  void read_queue( Shard& shard )
+  {
+    std::vector<std::vector<std::pair<FourTuple, TCPMessage>>> batches( shards_.size() );
+    for ( size_t i = 0; i < MAX_BATCH; i++ ) {
+      std::optional<InternetDatagram> ip_dgram = read_ipv4_datagram( shard.queue );
+      if ( not ip_dgram.has_value() ) {
+        break;
+      }
+      if ( auto segment = TCPOverIPv4Demultiplexer::parse_segment( std::move( *ip_dgram ) ) ) {
+        batches[shard_of( segment->first )].push_back( std::move( *segment ) );
+      }
+    }
+
+    for ( size_t index = 0; index < shards_.size(); index++ ) {
+      Shard& owner = *shards_[index];
+      if ( batches[index].empty() ) {
+        continue;
+      }
+      if ( &owner == &shard ) {
+        shard.demux.receive( std::move( batches[index] ) );
+      } else {
+        handed_off_segments_ += batches[index].size();
+        owner.hand_off( batches[index] );
+      }
+    }
+  }
+
+  void run( Shard& shard )
+  {
+    // The inbox comes first, so that a task posted before a datagram arrived (e.g. listen) runs before it.
+    EventLoop loop;
+    loop.add_rule( "inbox", shard.wakeup, Direction::In, [&] { shard.drain_inbox(); } );
+    loop.add_rule( "queue", shard.queue, Direction::In, [&] { read_queue( shard ); } );
+
+    uint64_t base_time = timestamp_ms();
+    while ( not stopping_ ) {
+      if ( loop.wait_next_event( TICK_MS ) == EventLoop::Result::Exit ) {
+        break;
+      }
+      const uint64_t next_time = timestamp_ms();
+      shard.demux.tick( next_time - base_time );
+      base_time = next_time;
+    }
+  }
+};
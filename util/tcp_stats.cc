@@ -0,0 +1,29 @@
+#include "tcp_stats.hh"
+
+#include <sstream>
+
+using namespace std;
+
+string TCPStats::to_string() const
+{
+  ostringstream out;
+  out << "sent " << segments_sent << " segments (" << bytes_sent << " bytes), received " << segments_received
+      << " segments (" << bytes_received << " bytes; " << segments_in_order << " in order, "
+      << segments_out_of_order << " out of order, " << segments_duplicate << " duplicate, "
+      << segments_beyond_window << " beyond the window), retransmitted " << segments_retransmitted << " segments ("
+      << bytes_retransmitted << " bytes), " << duplicate_acks << " duplicate ACKs, " << zero_window_events
+      << " zero-window events; srtt=";
+  if ( srtt_ms.has_value() ) {
+    out << *srtt_ms << "ms";
+  } else {
+    out << "none";
+  }
+  out << " rto=" << rto_ms << "ms snd_wnd=" << send_window;
+  if ( congestion_window.has_value() ) {
+    out << " cwnd=" << *congestion_window;
+  }
+  out << " rcv_wnd=" << receive_window << " in_flight=" << bytes_in_flight
+      << " reassembler_pending=" << reassembler_pending_bytes << "; rwnd-limited " << rwnd_limited_ms
+      << "ms, sndbuf-limited " << sndbuf_limited_ms << "ms";
+  return out.str();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/*
+ * A snapshot of one connection's transport statistics, similar to Linux's `struct tcp_info`.
+ *
+ * Counters cover the whole life of the connection. The rest describes its state when the snapshot
+ * was taken. Together they show why a transfer is slow: time limited by the receive window points
+ * to the peer, time limited by the send buffer points to this side, and neither points to the application.
+ */
+struct TCPStats
+{
+  // Segments and payload bytes handed to the network, including retransmissions and bare ACKs
+  uint64_t segments_sent {};
+  uint64_t bytes_sent {};
+
+  // Segments and payload bytes received from the network
+  uint64_t segments_received {};
+  uint64_t bytes_received {};
+
+  // How the received data segments lined up with the receive window. Duplicates and segments beyond
+  // the window are dropped before reassembly.
+  uint64_t segments_in_order {};
+  uint64_t segments_out_of_order {};
+  uint64_t segments_duplicate {};
+  uint64_t segments_beyond_window {};
+
+  // Retransmissions (timeouts, SACK or RACK losses, and tail loss probes)
+  uint64_t segments_retransmitted {};
+  uint64_t bytes_retransmitted {};
+
+  uint64_t duplicate_acks {};     // ACKs that acknowledged nothing new while data was in flight
+  uint64_t zero_window_events {}; // times the peer's receive window closed
+
+  // Round-trip time and retransmission timeout, in milliseconds
+  std::optional<uint64_t> srtt_ms {};
+  uint64_t rto_ms {};
+
+  uint64_t send_window {};                      // the peer's advertised window, in bytes
+  std::optional<uint64_t> congestion_window {}; // empty until the congestion window is first reduced
+  uint64_t receive_window {};                   // the window this side advertises (as scaled), in bytes
+  uint64_t bytes_in_flight {};
+  uint64_t reassembler_pending_bytes {}; // out-of-order bytes waiting for a gap to fill
+
+  // Time, in milliseconds, that data was waiting while the peer's window was full,
+  // and that the send buffer was full while the peer's window was not the limit
+  uint64_t rwnd_limited_ms {};
+  uint64_t sndbuf_limited_ms {};
+
+  std::string to_string() const;
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/*
+ * A hashed hierarchical timer wheel (Varghese and Lauck), with a clock counted in milliseconds.
+ *
+ * Each pending timer sits in one slot of one of four wheels of 64 slots. A timer due within 64 ms is in the
+ * slot for its millisecond; one due within 64^2 ms is in the slot of the second wheel for its 64 ms span, and
+ * so on up to 64^4 ms (about 4.6 hours; later timers wait in the last wheel and are placed again as the clock
+ * nears them). Advancing the clock visits the slots of the first wheel it passes, and each time that wheel
+ * comes round, empties the next slot of the wheel above into the wheels below.
+ *
+ * Scheduling and cancelling take constant time, as does each millisecond the clock advances: only timers that
+ * expire, or move down a wheel on their way to expiring, are touched, however many others are pending.
+ */
+template<typename T>
+class TimerWheel
+{
+public:
+  //! Names a timer, to cancel it. Once the timer has expired or been cancelled, the id names nothing.
+  struct TimerId
+  {
+    uint32_t index { NONE };
+    uint32_t generation {};
+  };
+
+  explicit TimerWheel( uint64_t now_ms = 0 ) : now_( now_ms ) { heads_.fill( NONE ); }
+
+  uint64_t now() const { return now_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  //! Start a timer that expires when the clock reaches `deadline_ms` (or on the next millisecond, if it has)
+  TimerId schedule( uint64_t deadline_ms, T value )
+  {
+    uint32_t index {};
+    if ( free_.empty() ) {
+      index = static_cast<uint32_t>( nodes_.size() );
+      nodes_.emplace_back();
+    } else {
+      index = free_.back();
+      free_.pop_back();
+    }
+    Node& node = nodes_[index];
+    node.deadline = std::max( deadline_ms, now_ + 1 );
+    node.value = std::move( value );
+    node.pending = true;
+    insert( index );
+    size_++;
+    return { index, node.generation };
+  }
+
+  //! Stop a timer before it expires. Returns false if it had already expired or been cancelled.
+  bool cancel( TimerId id )
+  {
+    if ( not pending( id ) ) {
+      return false;
+    }
+    unlink( id.index );
+    release( id.index );
+    return true;
+  }
+
+  //! Is the timer named by `id` still waiting to expire?
+  bool pending( TimerId id ) const
+  {
+    return id.index < nodes_.size() and nodes_[id.index].pending and nodes_[id.index].generation == id.generation;
+  }
+
+  //! Move the clock forward by `ms`, calling `expire( value )` for each timer that comes due, at its deadline
+  //! (timers due in the same millisecond in no particular order). `expire` may schedule and cancel timers.
+  template<typename ExpireFunction>
+  void advance( uint64_t ms, ExpireFunction&& expire )
+  {
+    for ( uint64_t i = 0; i < ms; i++ ) {
+      if ( size_ == 0 ) {
+        now_ += ms - i;
+        return;
+      }
+      now_++;
+
+      // When the first wheel comes round, bring the timers of the next 64 ms down from the wheels above.
+      for ( size_t level = 1; level < LEVELS and ( now_ & ( ( uint64_t { 1 } << ( BITS * level ) ) - 1 ) ) == 0;
+            level++ ) {
+        cascade( level, ( now_ >> ( BITS * level ) ) & MASK );
+      }
+
+      // Every timer left in this millisecond's slot is due now. Take them all before calling `expire`, which
+      // may add timers to the same slot (due a full turn of the wheel from now).
+      uint32_t index = heads_[now_ & MASK];
+      heads_[now_ & MASK] = NONE;
+      while ( index != NONE ) {
+        due_.push_back( { index, nodes_[index].generation } );
+        nodes_[index].slot = NONE;
+        index = nodes_[index].next;
+      }
+      for ( size_t j = 0; j < due_.size(); j++ ) {
+        const TimerId id = due_[j];
+        if ( pending( id ) ) { // an earlier `expire` may have cancelled it
+          T value = std::move( nodes_[id.index].value );
+          release( id.index );
+          expire( std::move( value ) );
+        }
+      }
+      due_.clear();
+    }
+  }
+
+private:
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t BITS = 6;
+  static constexpr size_t SLOTS = 1 << BITS;
+  static constexpr uint64_t MASK = SLOTS - 1;
+  static constexpr size_t LEVELS = 4;
+  static constexpr uint64_t RANGE = uint64_t { 1 } << ( BITS * LEVELS ); // farthest deadline a wheel can hold
+
+  struct Node
+  {
+    uint64_t deadline {};
+    T value {};
+    uint32_t prev { NONE };
+    uint32_t next { NONE };
+    uint32_t slot { NONE }; // index into heads_, or NONE when in no slot
+    uint32_t generation {};
+    bool pending {};
+  };
+
+  uint64_t now_;
+  size_t size_ {};
+  std::vector<Node> nodes_ {};
+  std::vector<uint32_t> free_ {};
+  std::array<uint32_t, SLOTS * LEVELS> heads_ {}; // first timer in each slot of each wheel
+  std::vector<TimerId> due_ {};
+
+  // Put a timer in the slot for its deadline, on the finest wheel whose turn reaches that far
+  void insert( uint32_t index )
+  {
+    Node& node = nodes_[index];
+    const uint64_t delta = node.deadline - now_;
+    size_t level = 0;
+    while ( level + 1 < LEVELS and delta >> ( BITS * ( level + 1 ) ) != 0 ) {
+      level++;
+    }
+    const uint64_t when = delta < RANGE ? node.deadline : now_ + RANGE - 1;
+    const uint32_t slot = static_cast<uint32_t>( level * SLOTS + ( ( when >> ( BITS * level ) ) & MASK ) );
+
+    node.slot = slot;
+    node.prev = NONE;
+    node.next = heads_[slot];
+    if ( node.next != NONE ) {
+      nodes_[node.next].prev = index;
+    }
+    heads_[slot] = index;
+  }
+
+  void unlink( uint32_t index )
+  {
+    Node& node = nodes_[index];
+    if ( node.slot == NONE ) {
+      return;
+    }
+    if ( node.prev != NONE ) {
+      nodes_[node.prev].next = node.next;
+    } else {
+      heads_[node.slot] = node.next;
+    }
+    if ( node.next != NONE ) {
+      nodes_[node.next].prev = node.prev;
+    }
+    node.slot = NONE;
+  }
+
+  void release( uint32_t index )
+  {
+    Node& node = nodes_[index];
+    node.pending = false;
+    node.generation++;
+    node.value = T {};
+    free_.push_back( index );
+    size_--;
+  }
+
+  // Move every timer in one slot of an upper wheel to the slot for its deadline on a finer wheel
+  void cascade( size_t level, uint64_t position )
+  {
+    const size_t slot = level * SLOTS + position;
+    uint32_t index = heads_[slot];
+    heads_[slot] = NONE;
+    while ( index != NONE ) {
+      const uint32_t next = nodes_[index].next;
+      insert( index );
+      index = next;
+    }
+  }
+};
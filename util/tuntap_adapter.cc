@@ -3,23 +3,57 @@
 
 using namespace std;
 
-optional<TCPMessage> TCPOverIPv4OverTunFdAdapter::read()
+namespace {
+// Largest datagram on a typical (Ethernet-sized) path
+constexpr size_t TYPICAL_MTU = 1500;
+} // namespace
+
+optional<InternetDatagram> read_ipv4_datagram( FileDescriptor& tun )
 {
-  vector<string> strs( 3 );
+  // The received payload keeps sharing the buffer it was read into (all the way into the inbound ByteStream),
+  // so a datagram of typical size is read into a buffer of about its own size. Only a larger one spills into
+  // the last buffer (and is then concatenated).
+  vector<string> strs( 4 );
   strs[0].resize( IPv4Header::LENGTH );
   strs[1].resize( TCPSegment::HEADER_LENGTH );
-  _tun.read( strs );
+  strs[2].resize( TYPICAL_MTU - IPv4Header::LENGTH - TCPSegment::HEADER_LENGTH );
+  tun.read( strs );
 
   InternetDatagram ip_dgram;
   if ( parse( ip_dgram, move( strs ) ) ) {
-    return unwrap_tcp_in_ip( move( ip_dgram ) );
+    return ip_dgram;
+  }
+  return {};
+}
+
+optional<TCPMessage> TCPOverIPv4OverTunFdAdapter::read()
+{
+  if ( auto ip_dgram = read_ipv4_datagram( _tun ) ) {
+    return unwrap_tcp_in_ip( move( *ip_dgram ) );
   }
   return {};
 }
 
 void TCPOverIPv4OverTunFdAdapter::write( const TCPMessage& seg )
 {
-  _tun.write( serialize( wrap_tcp_in_ip( seg ) ) );
+  // gather the headers and the payload slice into a single writev(), without copying the payload
+  const vector<Ref<string>> headers = wrap_tcp_headers( seg );
+  vector<string_view> buffers;
+  buffers.reserve( headers.size() + 1 );
+  for ( const auto& header : headers ) {
+    buffers.emplace_back( header.get() );
+  }
+  if ( not seg.sender->payload.empty() ) {
+    buffers.push_back( seg.sender->payload );
+  }
+  _tun.write( buffers );
+}
+
+void TCPOverIPv4OverTunFdAdapter::write_batch( span<const TCPMessage> batch )
+{
+  for ( const auto& seg : batch ) {
+    write( seg );
+  }
 }
 
 //! Specialize LossyFdAdapter to TCPOverIPv4OverTunFdAdapter
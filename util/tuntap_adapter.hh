@@ -6,15 +6,21 @@
 #include "tun.hh"
 
 #include <optional>
+#include <span>
 #include <utility>
 
 template<class T>
-concept TCPDatagramAdapter = requires( T a, TCPMessage seg ) {
+concept TCPDatagramAdapter = requires( T a, TCPMessage seg, std::span<const TCPMessage> batch ) {
   { a.write( seg ) } -> std::same_as<void>;
 
+  { a.write_batch( batch ) } -> std::same_as<void>;
+
   { a.read() } -> std::same_as<std::optional<TCPMessage>>;
 };
 
+//! Reads one IPv4 datagram from a TUN device or one of its queues (empty if it couldn't be parsed)
+std::optional<InternetDatagram> read_ipv4_datagram( FileDescriptor& tun );
+
 //! \brief A FD adapter for IPv4 datagrams read from and written to a TUN device
 class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter
 {
@@ -31,6 +37,10 @@ public:
   //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
   void write( const TCPMessage& seg );
 
+  //! Creates and writes an IPv4 datagram for each TCP segment in a batch
+  //! \note A TUN device accepts one packet per write, so this is one syscall per segment
+  void write_batch( std::span<const TCPMessage> batch );
+
   //! Access the underlying TUN device
   explicit operator TunFD&() { return _tun; }
 